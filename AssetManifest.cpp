@@ -0,0 +1,326 @@
+// AssetManifest.cpp
+#include "AssetManifest.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t kWatchMask = IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE |
+                                     IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                                     IN_MOVE_SELF | IN_ONLYDIR;
+
+std::string Join(const std::string& dirKey, const char* name) {
+    return dirKey.empty() ? std::string(name) : dirKey + '/' + name;
+}
+
+AssetInfo InfoOf(const struct stat& st) {
+    AssetInfo info;
+    info.size = static_cast<std::uint64_t>(st.st_size);
+    info.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return info;
+}
+
+// Directories still to be read, shared by the scan workers
+class DirQueue {
+public:
+    explicit DirQueue(const std::vector<std::string>& roots) : dirs_(roots.begin(), roots.end()) {}
+
+    void push(std::string dir) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirs_.push_back(std::move(dir));
+        ready_.notify_one();
+    }
+
+    // Next directory; false once the queue is empty and no worker can add more.
+    // `hadPrevious`: the caller is done with the directory its last pop() returned.
+    bool pop(std::string& dir, bool hadPrevious) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (hadPrevious) --busy_;
+        ready_.wait(lock, [&]() { return !dirs_.empty() || busy_ == 0; });
+        if (dirs_.empty()) {
+            ready_.notify_all();
+            return false;
+        }
+        dir = std::move(dirs_.front());
+        dirs_.pop_front();
+        ++busy_;
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::string> dirs_;
+    unsigned busy_ = 0;             // Workers reading a directory (may still push)
+};
+
+} // anonymous namespace
+
+AssetManifest::AssetManifest(std::filesystem::path root)
+    : root_(std::move(root)) {}
+
+AssetManifest::~AssetManifest() {
+    if (watcher_.joinable()) {
+        const std::uint64_t one = 1;
+        (void)::write(wakeFd_, &one, sizeof(one));
+        watcher_.join();
+    }
+    if (inotifyFd_ >= 0) ::close(inotifyFd_);
+    if (wakeFd_ >= 0) ::close(wakeFd_);
+}
+
+std::string AssetManifest::keyOf(const std::filesystem::path& relPath) {
+    std::string key = relPath.lexically_normal().generic_string();
+    while (key.rfind("./", 0) == 0) key.erase(0, 2);
+    return key == "." ? std::string() : key;
+}
+
+bool AssetManifest::build(unsigned threads, bool watch) {
+    if (ready()) return true;
+
+    const auto start = std::chrono::steady_clock::now();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (watch) {
+        inotifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd_ = ::eventfd(0, EFD_CLOEXEC);
+        if (inotifyFd_ < 0 || wakeFd_ < 0) {
+            std::cerr << "[AssetManifest] inotify unavailable (" << std::strerror(errno)
+                      << "), manifest will not follow changes\n";
+            if (inotifyFd_ >= 0) ::close(inotifyFd_);
+            inotifyFd_ = -1;
+        }
+    }
+
+    struct stat st;
+    if (::stat(root_.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        std::cerr << "[AssetManifest] cannot read " << root_ << '\n';
+        return false;
+    }
+
+    std::size_t dirCount = 0;
+    FileMap files = walk({std::string()}, threads, &dirCount);
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        files_ = std::move(files);
+        scanStats_.files = files_.size();
+    }
+    scanStats_.dirs = dirCount;
+    scanStats_.scanThreads = threads;
+    scanStats_.scanMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    scanStats_.watching = inotifyFd_ >= 0;
+
+    if (inotifyFd_ >= 0) {
+        watcher_ = std::thread([this]() { watchLoop(); });
+    }
+    ready_.store(true, std::memory_order_release);
+
+    std::cout << "[AssetManifest] " << scanStats_.files << " files in " << scanStats_.dirs
+              << " directories scanned in " << scanStats_.scanMs << " ms (" << threads
+              << " threads" << (scanStats_.watching ? ", watching" : "") << ")\n";
+    return true;
+}
+
+bool AssetManifest::lookup(const std::string& relPath, AssetInfo& info) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = files_.find(relPath);
+    if (it == files_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    info = it->second;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+ManifestStats AssetManifest::stats() const {
+    ManifestStats stats = scanStats_;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        stats.files = files_.size();
+    }
+    stats.events = events_.load(std::memory_order_relaxed);
+    stats.rescans = rescans_.load(std::memory_order_relaxed);
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// ---------------- Scanning ----------------
+
+AssetManifest::FileMap AssetManifest::walk(const std::vector<std::string>& roots, unsigned threads,
+                                           std::size_t* dirCount) {
+    DirQueue queue(roots);
+    std::vector<FileMap> found(threads);
+    std::atomic<std::size_t> dirs{0};
+
+    auto worker = [&](unsigned self) {
+        std::string dirKey;
+        for (bool held = false; queue.pop(dirKey, held);) {
+            held = true;
+            // Watch first, so nothing created while the directory is read goes unnoticed
+            if (inotifyFd_ >= 0) addWatch(dirKey);
+
+            const std::filesystem::path dirPath = dirKey.empty() ? root_ : root_ / dirKey;
+            DIR* dir = ::opendir(dirPath.c_str());
+            if (!dir) continue;
+            dirs.fetch_add(1, std::memory_order_relaxed);
+
+            const int fd = ::dirfd(dir);
+            while (const dirent* entry = ::readdir(dir)) {
+                const char* name = entry->d_name;
+                if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) continue;
+
+                if (entry->d_type == DT_DIR) {
+                    queue.push(Join(dirKey, name));
+                    continue;
+                }
+                // Regular files and symlinks to them (symlinked directories are not followed)
+                struct stat st;
+                if (::fstatat(fd, name, &st, 0) == 0 && S_ISREG(st.st_mode)) {
+                    found[self].emplace(Join(dirKey, name), InfoOf(st));
+                } else if (entry->d_type == DT_UNKNOWN && ::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                           S_ISDIR(st.st_mode)) {
+                    queue.push(Join(dirKey, name));
+                }
+            }
+            ::closedir(dir);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : pool) t.join();
+
+    FileMap files = std::move(found[0]);
+    for (unsigned t = 1; t < threads; ++t) {
+        files.insert(std::make_move_iterator(found[t].begin()), std::make_move_iterator(found[t].end()));
+    }
+    if (dirCount) *dirCount = dirs.load();
+    return files;
+}
+
+bool AssetManifest::addWatch(const std::string& dirKey) {
+    const std::filesystem::path dirPath = dirKey.empty() ? root_ : root_ / dirKey;
+    const int wd = ::inotify_add_watch(inotifyFd_, dirPath.c_str(), kWatchMask);
+    if (wd < 0) {
+        std::cerr << "[AssetManifest] cannot watch " << dirPath << ": " << std::strerror(errno)
+                  << " (raise fs.inotify.max_user_watches)\n";
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    dirs_[wd] = dirKey;
+    return true;
+}
+
+// ---------------- Watching ----------------
+
+void AssetManifest::watchLoop() {
+    alignas(inotify_event) char buf[64 * 1024];
+    pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+
+    while (true) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        const ssize_t len = ::read(inotifyFd_, buf, sizeof(buf));
+        if (len <= 0) continue;
+
+        for (ssize_t off = 0; off < len;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buf + off);
+            off += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            events_.fetch_add(1, std::memory_order_relaxed);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost: start over (existing watches are kept by the kernel)
+                std::cerr << "[AssetManifest] event queue overflow, rescanning\n";
+                FileMap files = walk({std::string()}, 1, nullptr);
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                files_ = std::move(files);
+                rescans_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            std::string dirKey;
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex_);
+                auto it = dirs_.find(event->wd);
+                if (it == dirs_.end()) continue;
+                dirKey = it->second;
+            }
+
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // The directory itself is gone; its parent reports the name change
+                if (event->mask & IN_IGNORED) {
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    dirs_.erase(event->wd);
+                }
+                continue;
+            }
+            if (event->len == 0) continue;
+
+            const std::string key = Join(dirKey, event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    FileMap files = walk({key}, 1, nullptr);
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    for (auto& file : files) files_[file.first] = file.second;
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    forgetDir(key);
+                }
+                continue;
+            }
+            refresh(key);
+        }
+    }
+}
+
+void AssetManifest::refresh(const std::string& key) {
+    struct stat st;
+    const bool exists = ::stat((root_ / key).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (exists) {
+        files_[key] = InfoOf(st);
+    } else {
+        files_.erase(key);
+    }
+}
+
+void AssetManifest::forgetDir(const std::string& dirKey) {
+    const std::string prefix = dirKey + '/';
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto it = files_.begin(); it != files_.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            it = files_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = dirs_.begin(); it != dirs_.end();) {
+        if (it->second == dirKey || it->second.compare(0, prefix.size(), prefix) == 0) {
+            it = dirs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// AssetManifest.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// What the manifest knows about one asset file
+struct AssetInfo {
+    std::uint64_t size = 0;
+    std::int64_t mtimeNs = 0;
+};
+
+struct ManifestStats {
+    std::size_t files = 0;
+    std::size_t dirs = 0;
+    double scanMs = 0;              // Cost of the first full scan
+    unsigned scanThreads = 0;
+    bool watching = false;          // inotify is keeping the manifest current
+    std::uint64_t events = 0;       // inotify events applied
+    std::uint64_t rescans = 0;      // Full rescans after an event queue overflow
+    std::uint64_t hits = 0;         // Lookups answered from memory
+    std::uint64_t misses = 0;       // Lookups for paths the manifest does not have
+};
+
+// In-memory index of every file under a resource directory: existence, size and mtime.
+//
+// Built once at startup by a parallel walk (one readdir + fstatat per entry, directories
+// handed out to worker threads), so loads can replace their per-file stat with a hash
+// probe. With watching on, each directory gets an inotify watch before it is read, and a
+// background thread applies creates, writes, deletes and renames as they happen; an
+// overflowed event queue triggers a full rescan. Keys are paths relative to the root
+// with '/' separators ("buildings/jiading.fbx").
+class AssetManifest {
+public:
+    explicit AssetManifest(std::filesystem::path root);
+    ~AssetManifest();
+
+    AssetManifest(const AssetManifest&) = delete;
+    AssetManifest& operator=(const AssetManifest&) = delete;
+
+    // Scan the root with `threads` workers (0 = hardware concurrency) and, with `watch`,
+    // keep following changes afterwards. False if the root cannot be read.
+    bool build(unsigned threads = 0, bool watch = true);
+
+    // Whether build() has completed
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+    // Look up a relative path; false if the manifest has no such file
+    bool lookup(const std::string& relPath, AssetInfo& info) const;
+
+    ManifestStats stats() const;
+
+    const std::filesystem::path& root() const { return root_; }
+
+    // Manifest key for a path relative to the root ('/' separators, no "." segments)
+    static std::string keyOf(const std::filesystem::path& relPath);
+
+private:
+    using FileMap = std::unordered_map<std::string, AssetInfo>;
+
+    std::filesystem::path root_;
+
+    mutable std::shared_mutex mutex_;       // Guards files_ and dirs_
+    FileMap files_;
+    std::unordered_map<int, std::string> dirs_;    // inotify watch -> directory key ("" = root)
+
+    std::atomic<bool> ready_{false};
+    int inotifyFd_ = -1;
+    int wakeFd_ = -1;                       // eventfd that stops the watcher
+    std::thread watcher_;
+
+    mutable std::atomic<std::uint64_t> hits_{0};
+    mutable std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> events_{0};
+    std::atomic<std::uint64_t> rescans_{0};
+    ManifestStats scanStats_;               // Set once by build()
+
+    // Walk the directories `roots` (keys) and everything below with `threads` workers,
+    // adding inotify watches when watching. Returns the files found and the number of directories.
+    FileMap walk(const std::vector<std::string>& roots, unsigned threads, std::size_t* dirCount);
+
+    // Record one watched directory; false if inotify refused it
+    bool addWatch(const std::string& dirKey);
+
+    void watchLoop();
+
+    // Re-stat one path after an event (drops it if it is gone)
+    void refresh(const std::string& key);
+
+    // Drop a directory's files after it was deleted or moved away
+    void forgetDir(const std::string& dirKey);
+};
@@ -0,0 +1,259 @@
+// AssetPack.cpp
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// ---------------- Pack file layout ----------------
+// PackHeader | asset bytes (each starting on a kAlign boundary, in ID order) |
+// PackEntry[count] (sorted by key) | string blob (keys, ids)
+// Stored in host byte order; the header magic guards against foreign files.
+
+constexpr char kPackMagic[8] = { 'H', 'C', 'P', 'A', 'C', 'K', '0', '1' };
+constexpr std::uint64_t kAlign = 64;
+
+struct PackHeader {
+    char          magic[8];
+    std::uint64_t count;
+    std::uint64_t indexOffset;      // First PackEntry; the string blob follows the index
+    std::uint64_t stringBytes;
+};
+
+struct PackEntry {
+    std::uint64_t offset;           // From the start of the file
+    std::uint64_t size;
+    std::uint32_t keyOff, keyLen;
+    std::uint32_t idOff,  idLen;
+};
+
+static_assert(sizeof(PackEntry) == 32, "pack entry layout changed");
+
+bool WriteAll(int fd, const void* data, std::size_t len) {
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    while (len > 0) {
+        const ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Append one loose file to the pack; returns its size through `size`
+bool CopyFile(int out, const std::filesystem::path& file, std::uint64_t& size) {
+    const int in = ::open(file.c_str(), O_RDONLY);
+    if (in < 0) {
+        std::cerr << "[AssetPack] cannot read " << file << ": " << std::strerror(errno) << '\n';
+        return false;
+    }
+    std::vector<char> buf(1 << 20);
+    size = 0;
+    bool ok = true;
+    while (true) {
+        const ssize_t n = ::read(in, buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        if (n == 0) break;
+        if (!WriteAll(out, buf.data(), static_cast<std::size_t>(n))) {
+            ok = false;
+            break;
+        }
+        size += static_cast<std::uint64_t>(n);
+    }
+    ::close(in);
+    return ok;
+}
+
+} // anonymous namespace
+
+AssetPack::~AssetPack() {
+    if (map_) ::munmap(const_cast<std::uint8_t*>(map_), size_);
+}
+
+std::unique_ptr<AssetPack> AssetPack::open(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(PackHeader)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<AssetPack> pack(new AssetPack());
+    pack->path_ = path;
+    pack->map_ = static_cast<const std::uint8_t*>(map);
+    pack->size_ = size;
+
+    PackHeader header;
+    std::memcpy(&header, pack->map_, sizeof(header));
+    // Every size is checked against what is left of the file before it is used, so a
+    // hostile count or length cannot wrap the arithmetic
+    if (std::memcmp(header.magic, kPackMagic, sizeof(header.magic)) != 0 ||
+        header.indexOffset < sizeof(PackHeader) || header.indexOffset > size ||
+        header.indexOffset % alignof(PackEntry) != 0 ||
+        header.count > (size - header.indexOffset) / sizeof(PackEntry)) {
+        std::cerr << "[AssetPack] ignoring malformed pack " << path << '\n';
+        return nullptr;
+    }
+    const std::uint64_t indexBytes = header.count * sizeof(PackEntry);
+    if (header.stringBytes != size - header.indexOffset - indexBytes) {
+        std::cerr << "[AssetPack] ignoring malformed pack " << path << '\n';
+        return nullptr;
+    }
+
+    pack->count_ = static_cast<std::size_t>(header.count);
+    pack->entries_ = pack->map_ + header.indexOffset;
+    pack->strings_ = reinterpret_cast<const char*>(pack->map_ + header.indexOffset + indexBytes);
+    pack->stringBytes_ = static_cast<std::size_t>(header.stringBytes);
+
+    // Validate every range once, so find() can trust the index
+    const auto* entries = static_cast<const PackEntry*>(pack->entries_);
+    for (std::size_t i = 0; i < pack->count_; ++i) {
+        const PackEntry& e = entries[i];
+        if (e.offset < sizeof(PackHeader) || e.offset > header.indexOffset ||
+            e.size > header.indexOffset - e.offset ||
+            std::uint64_t(e.keyOff) + e.keyLen > header.stringBytes ||
+            std::uint64_t(e.idOff) + e.idLen > header.stringBytes) {
+            std::cerr << "[AssetPack] ignoring pack with out-of-range entry " << path << '\n';
+            return nullptr;
+        }
+    }
+
+    // Only the index is hot; asset pages are read ahead per load (willNeed)
+    ::madvise(const_cast<std::uint8_t*>(pack->map_), size, MADV_RANDOM);
+    return pack;
+}
+
+bool AssetPack::find(std::string_view key, std::string_view& bytes) const {
+    const auto* begin = static_cast<const PackEntry*>(entries_);
+    const auto* end = begin + count_;
+    auto keyOf = [&](const PackEntry& e) { return std::string_view(strings_ + e.keyOff, e.keyLen); };
+
+    const auto* it = std::lower_bound(begin, end, key, [&](const PackEntry& e, std::string_view k) {
+        return keyOf(e) < k;
+    });
+    if (it == end || keyOf(*it) != key) return false;
+
+    bytes = std::string_view(reinterpret_cast<const char*>(map_ + it->offset),
+                             static_cast<std::size_t>(it->size));
+    return true;
+}
+
+void AssetPack::willNeed(std::string_view bytes) {
+    if (bytes.empty()) return;
+    const std::uintptr_t page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const auto start = reinterpret_cast<std::uintptr_t>(bytes.data()) & ~(page - 1);
+    const auto end = reinterpret_cast<std::uintptr_t>(bytes.data()) + bytes.size();
+    ::madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+}
+
+bool AssetPack::write(const std::filesystem::path& path, std::vector<PackSource> sources) {
+    // Data in ID order: a subtree's assets end up contiguous
+    std::sort(sources.begin(), sources.end(),
+              [](const PackSource& a, const PackSource& b) { return a.id < b.id; });
+
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "[AssetPack] cannot create " << tmp << ": " << std::strerror(errno) << '\n';
+        return false;
+    }
+
+    std::vector<PackEntry> entries;
+    std::string strings;
+    entries.reserve(sources.size());
+
+    static const char zeros[kAlign] = {};
+    std::uint64_t offset = sizeof(PackHeader);
+    bool ok = ::lseek(fd, sizeof(PackHeader), SEEK_SET) >= 0;
+
+    for (const PackSource& src : sources) {
+        if (!ok) break;
+        const std::uint64_t pad = (kAlign - offset % kAlign) % kAlign;
+        ok = WriteAll(fd, zeros, pad);
+        offset += pad;
+
+        PackEntry e {};
+        e.offset = offset;
+        ok = ok && CopyFile(fd, src.file, e.size);
+        offset += e.size;
+
+        e.keyOff = static_cast<std::uint32_t>(strings.size());
+        e.keyLen = static_cast<std::uint32_t>(src.key.size());
+        strings += src.key;
+        e.idOff = static_cast<std::uint32_t>(strings.size());
+        e.idLen = static_cast<std::uint32_t>(src.id.size());
+        strings += src.id;
+        entries.push_back(e);
+    }
+
+    if (ok && strings.size() > 0xFFFFFFFFu) {
+        std::cerr << "[AssetPack] string table exceeds 4 GiB\n";
+        ok = false;
+    }
+
+    // Index sorted by key for find()
+    std::sort(entries.begin(), entries.end(), [&](const PackEntry& a, const PackEntry& b) {
+        return std::string_view(strings.data() + a.keyOff, a.keyLen) <
+               std::string_view(strings.data() + b.keyOff, b.keyLen);
+    });
+    for (std::size_t i = 1; ok && i < entries.size(); ++i) {
+        if (std::string_view(strings.data() + entries[i].keyOff, entries[i].keyLen) ==
+            std::string_view(strings.data() + entries[i - 1].keyOff, entries[i - 1].keyLen)) {
+            std::cerr << "[AssetPack] duplicate key "
+                      << std::string_view(strings.data() + entries[i].keyOff, entries[i].keyLen) << '\n';
+            ok = false;
+        }
+    }
+
+    const std::uint64_t pad = (alignof(PackEntry) - offset % alignof(PackEntry)) % alignof(PackEntry);
+    PackHeader header {};
+    std::memcpy(header.magic, kPackMagic, sizeof(header.magic));
+    header.count       = entries.size();
+    header.indexOffset = offset + pad;
+    header.stringBytes = strings.size();
+
+    ok = ok &&
+        WriteAll(fd, zeros, pad) &&
+        WriteAll(fd, entries.data(), entries.size() * sizeof(PackEntry)) &&
+        WriteAll(fd, strings.data(), strings.size()) &&
+        ::pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+        ::fsync(fd) == 0;
+    ::close(fd);
+
+    std::error_code ec;
+    if (!ok) {
+        std::cerr << "[AssetPack] pack write failed: " << path << '\n';
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::cerr << "[AssetPack] pack rename failed: " << ec.message() << '\n';
+        return false;
+    }
+    return true;
+}
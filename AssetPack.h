@@ -0,0 +1,59 @@
+// AssetPack.h
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One asset to put into a pack
+struct PackSource {
+    std::string id;                     // Owning BlockTree node; the data section is ordered by it
+    std::string key;                    // Resource path relative to the resource root (manifest key)
+    std::filesystem::path file;         // Loose file to copy the bytes from
+};
+
+// Read-only archive of many asset files, mapped once and served as byte ranges.
+//
+// A building with thousands of tiny artifacts costs thousands of open/read calls when its
+// children are preloaded; packed, it is one mapping whose pages the kernel reads ahead in
+// ID order (so a subtree's assets sit next to each other). Lookups binary-search an index
+// sorted by key and return a view into the mapping: no copy, no syscall. The mapping lives
+// as long as the pack, so views stay valid while it is mounted.
+class AssetPack {
+public:
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Map a pack file; nullptr if it is missing or malformed
+    static std::unique_ptr<AssetPack> open(const std::filesystem::path& path);
+
+    // Write `sources` (in ID order) into a new pack, via a temporary file renamed into
+    // place. False if a source cannot be read or the pack cannot be written.
+    static bool write(const std::filesystem::path& path, std::vector<PackSource> sources);
+
+    // Bytes of the asset stored under `key`; false if the pack does not hold it
+    bool find(std::string_view key, std::string_view& bytes) const;
+
+    // Ask the kernel to start reading an asset's pages (loads are about to touch them)
+    static void willNeed(std::string_view bytes);
+
+    std::size_t assetCount() const { return count_; }
+    std::size_t mappedBytes() const { return size_; }
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    AssetPack() = default;
+
+    std::filesystem::path path_;
+    const std::uint8_t* map_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+    const void* entries_ = nullptr;     // PackEntry[count_], sorted by key
+    const char* strings_ = nullptr;
+    std::size_t stringBytes_ = 0;
+};
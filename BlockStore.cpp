@@ -0,0 +1,640 @@
+// BlockStore.cpp
+#include "BlockStore.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// ---------------- CRC-32 (IEEE) ----------------
+
+struct Crc32Table {
+    std::uint32_t v[256];
+    Crc32Table() {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            v[i] = c;
+        }
+    }
+};
+
+std::uint32_t Crc32(const std::uint8_t* data, std::size_t len) {
+    static const Crc32Table table;
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < len; ++i) {
+        c = table.v[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+// ---------------- Little-endian encoding helpers ----------------
+
+void PutInt(std::vector<std::uint8_t>& out, std::uint64_t v, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<std::uint8_t>(v >> (i * 8)));
+    }
+}
+
+void PutString(std::vector<std::uint8_t>& out, const std::string& s) {
+    PutInt(out, s.size(), 4);
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+// Bounds-checked reader over a byte range
+class Reader {
+public:
+    Reader(const std::uint8_t* p, std::size_t n) : p_(p), end_(p + n) {}
+
+    bool getInt(std::uint64_t& v, std::size_t bytes) {
+        if (static_cast<std::size_t>(end_ - p_) < bytes) return false;
+        v = 0;
+        for (std::size_t i = 0; i < bytes; ++i) {
+            v |= std::uint64_t(p_[i]) << (i * 8);
+        }
+        p_ += bytes;
+        return true;
+    }
+
+    bool getString(std::string& s) {
+        std::uint64_t len = 0;
+        if (!getInt(len, 4) || static_cast<std::uint64_t>(end_ - p_) < len) return false;
+        s.assign(reinterpret_cast<const char*>(p_), static_cast<std::size_t>(len));
+        p_ += len;
+        return true;
+    }
+
+    bool getBytes(std::uint8_t* out, std::size_t n) {
+        if (static_cast<std::size_t>(end_ - p_) < n) return false;
+        std::memcpy(out, p_, n);
+        p_ += n;
+        return true;
+    }
+
+    bool done() const { return p_ == end_; }
+
+private:
+    const std::uint8_t* p_;
+    const std::uint8_t* end_;
+};
+
+void EncodeBlock(std::vector<std::uint8_t>& out, const CandidateBlock& b) {
+    PutString(out, b.id);
+    PutString(out, b.parentId);
+    PutInt(out, static_cast<std::uint32_t>(b.index), 4);
+    PutInt(out, static_cast<std::uint64_t>(b.timestamp), 8);
+    PutInt(out, b.nonce, 4);
+    PutString(out, b.name);
+    PutString(out, b.filePath.string());
+    PutInt(out, static_cast<std::uint8_t>(b.cls), 1);
+    out.insert(out.end(), b.hash.begin(), b.hash.end());
+}
+
+// NodeClass values the arrays indexed by class (class lists, counts) have room for
+bool ValidClass(std::uint64_t cls) {
+    return cls <= static_cast<std::uint64_t>(NodeClass::Tiny);
+}
+
+bool DecodeBlock(const std::uint8_t* p, std::size_t n, CandidateBlock& b) {
+    Reader r(p, n);
+    std::uint64_t index = 0, timestamp = 0, nonce = 0, cls = 0;
+    std::string path;
+    if (!r.getString(b.id) || !r.getString(b.parentId) ||
+        !r.getInt(index, 4) || !r.getInt(timestamp, 8) || !r.getInt(nonce, 4) ||
+        !r.getString(b.name) || !r.getString(path) || !r.getInt(cls, 1) ||
+        !r.getBytes(b.hash.data(), b.hash.size()) || !r.done() || !ValidClass(cls)) {
+        return false;
+    }
+    b.index     = static_cast<int>(static_cast<std::uint32_t>(index));
+    b.timestamp = static_cast<std::int64_t>(timestamp);
+    b.nonce     = static_cast<std::uint32_t>(nonce);
+    b.filePath  = std::filesystem::path(path);
+    b.cls       = static_cast<NodeClass>(cls);
+    return true;
+}
+
+bool WriteAll(int fd, const std::uint8_t* data, std::size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len  -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Wait before the flusher retries a failed write
+constexpr std::chrono::seconds kRetryDelay{1};
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// ---------------- Snapshot file layout ----------------
+// Header | NodeRecord[nodeCount] | string blob (ids, names, paths)
+// Stored in host byte order; the header magic guards against foreign files.
+
+constexpr char kSnapshotMagic[8] = { 'H', 'C', 'S', 'N', 'A', 'P', '0', '1' };
+constexpr std::uint32_t kNoParent = 0xFFFFFFFFu;
+
+struct SnapshotHeader {
+    char          magic[8];
+    std::uint64_t generation;
+    std::uint64_t nodeCount;
+    std::uint64_t stringBytes;
+};
+
+struct NodeRecord {
+    std::uint32_t parent;       // Record index of the parent (kNoParent for the root)
+    std::int32_t  index;
+    std::int64_t  timestamp;
+    std::uint32_t nonce;
+    std::uint32_t cls;
+    std::uint32_t idOff,   idLen;
+    std::uint32_t nameOff, nameLen;
+    std::uint32_t pathOff, pathLen;
+    std::uint8_t  hash[32];
+};
+
+static_assert(sizeof(NodeRecord) == 80, "snapshot record layout changed");
+
+} // anonymous namespace
+
+// ---------------- BlockLog ----------------
+
+BlockLog::~BlockLog() {
+    close();
+}
+
+bool BlockLog::open(const std::filesystem::path& path, std::uint64_t validBytes) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[BlockLog] cannot open " << path << ": " << std::strerror(errno) << '\n';
+        return false;
+    }
+
+    // Drop a torn tail so new records follow the last intact one
+    if (::ftruncate(fd_, static_cast<off_t>(validBytes)) != 0 ||
+        ::lseek(fd_, static_cast<off_t>(validBytes), SEEK_SET) < 0) {
+        std::cerr << "[BlockLog] cannot position " << path << ": " << std::strerror(errno) << '\n';
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    durable_ = validBytes;
+    failed_ = false;
+    stopping_ = false;
+    flusher_ = std::thread(&BlockLog::flusherLoop, this);
+    return true;
+}
+
+void BlockLog::close() {
+    if (fd_ < 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (flusher_.joinable()) flusher_.join();
+
+    if (!sync()) {
+        std::cerr << "[BlockLog] closing with " << pendingRecords_ << " unwritten records\n";
+        pending_.clear();
+        pendingRecords_ = 0;
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void BlockLog::setGroupCommit(std::size_t groupSize, std::chrono::milliseconds groupDelay) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    groupSize_  = groupSize == 0 ? 1 : groupSize;
+    groupDelay_ = groupDelay;
+}
+
+void BlockLog::append(const CandidateBlock& block) {
+    std::vector<std::uint8_t> payload;
+    payload.reserve(128);
+    EncodeBlock(payload, block);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pendingRecords_ == 0) {
+        firstPending_ = std::chrono::steady_clock::now();
+        cv_.notify_all();
+    }
+
+    PutInt(pending_, payload.size(), 4);
+    PutInt(pending_, Crc32(payload.data(), payload.size()), 4);
+    pending_.insert(pending_.end(), payload.begin(), payload.end());
+    ++pendingRecords_;
+
+    if (pendingRecords_ >= groupSize_) {
+        flushLocked();
+    }
+}
+
+bool BlockLog::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushLocked();
+}
+
+bool BlockLog::failed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+bool BlockLog::flushLocked() {
+    if (pendingRecords_ == 0 || fd_ < 0) return !failed_;
+
+    if (!WriteAll(fd_, pending_.data(), pending_.size()) || ::fdatasync(fd_) != 0) {
+        std::cerr << "[BlockLog] write failed: " << std::strerror(errno) << '\n';
+        // A torn record would end replay there and hide every record after it: cut the
+        // log back to the last durable one and keep the records for the next attempt
+        if (::ftruncate(fd_, static_cast<off_t>(durable_)) != 0 ||
+            ::lseek(fd_, static_cast<off_t>(durable_), SEEK_SET) < 0) {
+            std::cerr << "[BlockLog] cannot roll back to " << durable_ << ": "
+                      << std::strerror(errno) << '\n';
+        }
+        failed_ = true;
+        firstPending_ = std::chrono::steady_clock::now() + kRetryDelay;
+        return false;
+    }
+
+    durable_ += pending_.size();
+    failed_ = false;
+    pending_.clear();
+    pendingRecords_ = 0;
+    return true;
+}
+
+void BlockLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (pendingRecords_ == 0) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        const auto deadline = firstPending_ + groupDelay_;
+        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout && pendingRecords_ > 0 &&
+            std::chrono::steady_clock::now() >= firstPending_ + groupDelay_) {
+            flushLocked();
+        }
+    }
+}
+
+std::uint64_t BlockLog::replay(const std::filesystem::path& path,
+                               const std::function<void(const CandidateBlock&)>& fn) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return 0;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const auto* base = static_cast<const std::uint8_t*>(map);
+    std::uint64_t offset = 0;
+
+    while (offset + 8 <= size) {
+        Reader header(base + offset, 8);
+        std::uint64_t len = 0, crc = 0;
+        header.getInt(len, 4);
+        header.getInt(crc, 4);
+
+        if (offset + 8 + len > size) break;
+        const std::uint8_t* payload = base + offset + 8;
+        if (Crc32(payload, static_cast<std::size_t>(len)) != crc) break;
+
+        CandidateBlock block;
+        if (!DecodeBlock(payload, static_cast<std::size_t>(len), block)) break;
+
+        fn(block);
+        offset += 8 + len;
+    }
+
+    ::munmap(map, size);
+    return offset;
+}
+
+// ---------------- Snapshot ----------------
+
+bool WriteSnapshot(const BlockTree& tree, const std::filesystem::path& path,
+                   std::uint64_t generation) {
+    std::vector<NodeRecord> records;
+    std::vector<std::uint8_t> strings;
+    records.reserve(tree.size());
+
+    auto addString = [&](std::string_view s, std::uint32_t& off, std::uint32_t& len) {
+        off = static_cast<std::uint32_t>(strings.size());
+        len = static_cast<std::uint32_t>(s.size());
+        strings.insert(strings.end(), s.begin(), s.end());
+    };
+
+    // Arena order already puts every parent before its children, so record i is slot i
+    for (NodeIndex slot = 0; slot < tree.size(); ++slot) {
+        const NodeRef node = tree.node(slot);
+        const NodeRef parent = node.parent();
+
+        NodeRecord rec {};
+        rec.parent    = parent ? parent.slot() : kNoParent;
+        rec.index     = node.index();
+        rec.timestamp = node.timestamp();
+        rec.nonce     = node.nonce();
+        rec.cls       = static_cast<std::uint32_t>(node.cls());
+        addString(node.id(), rec.idOff, rec.idLen);
+        addString(node.name(), rec.nameOff, rec.nameLen);
+        addString(node.filePath(), rec.pathOff, rec.pathLen);
+        std::memcpy(rec.hash, node.hash().data(), sizeof(rec.hash));
+
+        records.push_back(rec);
+    }
+
+    if (strings.size() > 0xFFFFFFFFu) {
+        std::cerr << "[BlockStore] snapshot string table exceeds 4 GiB\n";
+        return false;
+    }
+
+    SnapshotHeader header {};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.generation  = generation;
+    header.nodeCount   = records.size();
+    header.stringBytes = strings.size();
+
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "[BlockStore] cannot create " << tmp << ": " << std::strerror(errno) << '\n';
+        return false;
+    }
+
+    const bool ok =
+        WriteAll(fd, reinterpret_cast<const std::uint8_t*>(&header), sizeof(header)) &&
+        WriteAll(fd, reinterpret_cast<const std::uint8_t*>(records.data()),
+                 records.size() * sizeof(NodeRecord)) &&
+        WriteAll(fd, strings.data(), strings.size()) &&
+        ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!ok) {
+        std::cerr << "[BlockStore] snapshot write failed: " << std::strerror(errno) << '\n';
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::cerr << "[BlockStore] snapshot rename failed: " << ec.message() << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool LoadSnapshot(const std::filesystem::path& path, BlockTree& tree,
+                  std::uint64_t& generation, std::size_t& nodeCount) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    ::madvise(map, size, MADV_SEQUENTIAL);
+
+    const auto* base = static_cast<const std::uint8_t*>(map);
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    // Sizes are checked against the file before they are multiplied or added
+    const std::uint64_t body = size - sizeof(SnapshotHeader);
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.nodeCount == 0 || header.nodeCount > body / sizeof(NodeRecord) ||
+        header.stringBytes != body - header.nodeCount * sizeof(NodeRecord)) {
+        std::cerr << "[BlockStore] ignoring malformed snapshot " << path << '\n';
+        ::munmap(map, size);
+        return false;
+    }
+
+    const auto* records = reinterpret_cast<const NodeRecord*>(base + sizeof(SnapshotHeader));
+    const char* strings = reinterpret_cast<const char*>(records + header.nodeCount);
+
+    auto view = [&](std::uint32_t off, std::uint32_t len) {
+        if (std::uint64_t(off) + len > header.stringBytes) {
+            throw std::runtime_error("snapshot string out of range");
+        }
+        return std::string_view(strings + off, len);
+    };
+
+    bool ok = true;
+    try {
+        for (std::uint64_t i = 0; i < header.nodeCount; ++i) {
+            const NodeRecord& rec = records[i];
+            if (i == 0 ? rec.parent != kNoParent : rec.parent >= i) {
+                throw std::runtime_error("snapshot records out of order");
+            }
+            if (!ValidClass(rec.cls)) {
+                throw std::runtime_error("snapshot record has an unknown class");
+            }
+
+            // Fields are borrowed straight from the mapping; the tree copies them into its pool
+            BlockView block;
+            block.id        = view(rec.idOff, rec.idLen);
+            block.index     = rec.index;
+            block.timestamp = rec.timestamp;
+            block.nonce     = rec.nonce;
+            block.name      = view(rec.nameOff, rec.nameLen);
+            block.filePath  = view(rec.pathOff, rec.pathLen);
+            block.cls       = static_cast<NodeClass>(rec.cls);
+            std::memcpy(block.hash.data(), rec.hash, sizeof(rec.hash));
+
+            // Records are in slot order, so the parent's slot is its record index
+            if (i == 0) {
+                CandidateBlock root;
+                root.id        = std::string(block.id);
+                root.index     = block.index;
+                root.timestamp = block.timestamp;
+                root.nonce     = block.nonce;
+                root.name      = std::string(block.name);
+                root.filePath  = std::filesystem::path(std::string(block.filePath));
+                root.cls       = NodeClass::Root;
+                root.hash      = block.hash;
+                tree.restoreNode(root);
+            } else {
+                tree.restoreNode(static_cast<NodeIndex>(rec.parent), block);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[BlockStore] snapshot load failed: " << e.what() << '\n';
+        ok = false;
+    }
+
+    ::munmap(map, size);
+
+    generation = header.generation;
+    nodeCount  = static_cast<std::size_t>(header.nodeCount);
+    return ok;
+}
+
+// ---------------- BlockStore ----------------
+
+BlockStore::BlockStore(const std::filesystem::path& dir)
+    : dir_(dir) {}
+
+BlockStore::~BlockStore() {
+    log_.close();
+    if (lockFd_ >= 0) ::close(lockFd_);     // Releases the flock
+}
+
+bool BlockStore::lockDir() {
+    const std::filesystem::path path = dir_ / "LOCK";
+    lockFd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd_ < 0) {
+        std::cerr << "[BlockStore] cannot open " << path << ": " << std::strerror(errno) << '\n';
+        return false;
+    }
+    if (::flock(lockFd_, LOCK_EX | LOCK_NB) != 0) {
+        std::cerr << "[BlockStore] " << dir_ << " is in use by another process ("
+                  << std::strerror(errno) << ")\n";
+        ::close(lockFd_);
+        lockFd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path BlockStore::snapshotPath() const {
+    return dir_ / "snapshot.bin";
+}
+
+std::filesystem::path BlockStore::logPath(std::uint64_t generation) const {
+    return dir_ / ("blocks." + std::to_string(generation) + ".log");
+}
+
+bool BlockStore::open(BlockTree& tree) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        std::cerr << "[BlockStore] cannot create " << dir_ << ": " << ec.message() << '\n';
+        return false;
+    }
+    // Two processes appending to (and truncating) the same log would corrupt it
+    if (lockFd_ < 0 && !lockDir()) return false;
+
+    // 1. Snapshot (optional)
+    bool haveSnapshot = false;
+    const auto snapStart = std::chrono::steady_clock::now();
+    std::size_t snapNodes = 0;
+    if (std::filesystem::exists(snapshotPath())) {
+        haveSnapshot = LoadSnapshot(snapshotPath(), tree, generation_, snapNodes);
+        if (!haveSnapshot) return false;
+        std::cout << "[BlockStore] snapshot gen=" << generation_ << ": " << snapNodes
+                  << " nodes loaded in " << MsSince(snapStart) << " ms\n";
+    }
+
+    // 2. Replay blocks accepted after the snapshot
+    const auto replayStart = std::chrono::steady_clock::now();
+    std::size_t replayed = 0;
+    std::uint64_t validBytes = 0;
+    try {
+        validBytes = BlockLog::replay(logPath(generation_), [&](const CandidateBlock& block) {
+            tree.restoreNode(block);
+            ++replayed;
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "[BlockStore] log replay failed: " << e.what() << '\n';
+        return false;
+    }
+    std::cout << "[BlockStore] log gen=" << generation_ << ": " << replayed
+              << " blocks replayed in " << MsSince(replayStart) << " ms\n";
+
+    // Restored nodes only get their Merkle aggregates here, in one bottom-up pass
+    const auto aggregateStart = std::chrono::steady_clock::now();
+    tree.refreshAggregates();
+    tree.refreshIndexes();
+    std::cout << "[BlockStore] aggregates rebuilt in " << MsSince(aggregateStart)
+              << " ms, root=" << HashToHex(tree.aggregateRoot()) << '\n';
+
+    // 3. Logs of older / abandoned generations are no longer needed
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("blocks.", 0) == 0 && entry.path() != logPath(generation_)) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    if (!log_.open(logPath(generation_), validBytes)) return false;
+
+    // A brand-new store starts with the genesis root so later replays can rebuild the chain
+    if (!haveSnapshot && replayed == 0) {
+        log_.append(BlockTree::toBlock(tree.root()));
+        if (!log_.sync()) return false;
+    }
+
+    sinceSnapshot_ = replayed;
+    return true;
+}
+
+void BlockStore::append(const BlockTree& tree, NodeRef node) {
+    log_.append(BlockTree::toBlock(node));
+
+    if (snapshotInterval_ > 0 && ++sinceSnapshot_ >= snapshotInterval_) {
+        snapshot(tree);
+    }
+}
+
+bool BlockStore::sync() {
+    return log_.sync();
+}
+
+bool BlockStore::snapshot(const BlockTree& tree) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::uint64_t next = generation_ + 1;
+
+    // Everything up to now goes into the snapshot; new blocks go to the next log.
+    // Until the snapshot is renamed into place the old snapshot + old log stay authoritative.
+    // Records the log failed to write are covered by the snapshot once it is in place.
+    log_.sync();
+    if (!WriteSnapshot(tree, snapshotPath(), next)) return false;
+
+    if (!log_.open(logPath(next), 0)) return false;
+
+    std::error_code ec;
+    std::filesystem::remove(logPath(generation_), ec);
+    generation_    = next;
+    sinceSnapshot_ = 0;
+
+    std::cout << "[BlockStore] snapshot gen=" << generation_ << ": " << tree.size()
+              << " nodes written in " << MsSince(start) << " ms\n";
+    return true;
+}
@@ -0,0 +1,124 @@
+// BlockStore.h
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BlockTree.h"
+
+// Append-only binary log of accepted blocks with group-commit fsync.
+//
+// Record:  u32 payload length | u32 CRC-32 of payload | payload
+// Payload: u32 len, id | u32 len, parentId | i32 index | i64 timestamp | u32 nonce |
+//          u32 len, name | u32 len, file path | u8 class | 32-byte hash
+// (integers little-endian; an empty parentId marks the root record)
+class BlockLog {
+public:
+    BlockLog() = default;
+    ~BlockLog();
+
+    BlockLog(const BlockLog&) = delete;
+    BlockLog& operator=(const BlockLog&) = delete;
+
+    // Open (or create) a log for appending. `validBytes` is the length of the intact
+    // prefix found by replay(); anything after it (a torn tail from a crash) is cut off.
+    bool open(const std::filesystem::path& path, std::uint64_t validBytes);
+    void close();
+
+    // Buffer one record. Pending records are written with a single write + fdatasync
+    // once `groupSize` of them are waiting or the oldest has waited `groupDelay`.
+    void append(const CandidateBlock& block);
+
+    // Write and fdatasync everything buffered so far. False if that failed: the log is cut
+    // back to its last durable record and the records stay pending for the next attempt.
+    bool sync();
+
+    // The last write failed and has not been retried successfully yet
+    bool failed();
+
+    void setGroupCommit(std::size_t groupSize, std::chrono::milliseconds groupDelay);
+
+    // Read every intact record of a log file in order. Stops at the first torn or
+    // corrupt record and returns the number of valid bytes (0 if the file is missing).
+    static std::uint64_t replay(const std::filesystem::path& path,
+                                const std::function<void(const CandidateBlock&)>& fn);
+
+private:
+    int fd_ = -1;
+    std::uint64_t durable_ = 0;     // Log length covered by the last successful fdatasync
+    bool failed_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::uint8_t> pending_;
+    std::size_t pendingRecords_ = 0;
+    std::chrono::steady_clock::time_point firstPending_;
+    std::size_t groupSize_ = 64;
+    std::chrono::milliseconds groupDelay_{5};
+    std::thread flusher_;
+    bool stopping_ = false;
+
+    bool flushLocked();
+    void flusherLoop();
+};
+
+// Compact, mmap-able image of a whole tree (nodes in arena order, parents before children).
+// Written to a temporary file and renamed into place, so a reader never sees a partial file.
+bool WriteSnapshot(const BlockTree& tree, const std::filesystem::path& path,
+                   std::uint64_t generation);
+
+// Map a snapshot and restore its nodes into an empty tree. Returns false if the file
+// is missing or malformed; `generation` is the log generation the snapshot covers.
+bool LoadSnapshot(const std::filesystem::path& path, BlockTree& tree,
+                  std::uint64_t& generation, std::size_t& nodeCount);
+
+// Durable storage for a BlockTree: latest snapshot + the log of blocks accepted since.
+// Each snapshot starts a new log generation (blocks.<generation>.log), older logs are removed.
+class BlockStore {
+public:
+    explicit BlockStore(const std::filesystem::path& dir);
+    ~BlockStore();
+
+    // Restore the tree from snapshot + log replay (timings are reported on stdout)
+    // and open the log for appending. A fresh store records the genesis root first.
+    // Takes an exclusive lock on the directory (<dir>/LOCK, held until destruction):
+    // fails if another process already has the store open.
+    bool open(BlockTree& tree);
+
+    // Record a node that was just committed to the tree; may trigger a periodic snapshot
+    void append(const BlockTree& tree, NodeRef node);
+
+    // Force pending log records to disk (before acknowledging the blocks appended).
+    // False if they could not be written; see BlockLog::sync.
+    bool sync();
+
+    // False while the log cannot be written; new blocks must not be accepted then
+    bool writable() { return !log_.failed(); }
+
+    // Write a snapshot of the current tree and start a new log generation
+    bool snapshot(const BlockTree& tree);
+
+    // Take a snapshot automatically every `blocks` appended blocks (0 = never)
+    void setSnapshotInterval(std::size_t blocks) { snapshotInterval_ = blocks; }
+
+    BlockLog& log() { return log_; }
+
+private:
+    std::filesystem::path dir_;
+    int lockFd_ = -1;
+    std::uint64_t generation_ = 0;
+    std::size_t sinceSnapshot_ = 0;
+    std::size_t snapshotInterval_ = 100000;
+    BlockLog log_;
+
+    std::filesystem::path snapshotPath() const;
+    std::filesystem::path logPath(std::uint64_t generation) const;
+
+    bool lockDir();
+};
@@ -1,11 +1,16 @@
 // BlockTree.cpp
 #include "BlockTree.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <sstream>
-#include <iomanip>
-#include <functional>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace {
 
@@ -17,6 +22,176 @@ std::int64_t NowMs() {
     ).count();
 }
 
+// Serialized form of a node as fed to the hash backend (all integers little-endian):
+//   u32 len, id | i32 index | i64 timestamp | u32 len, name | u32 len, file path |
+//   u8 class | parent hash (32 bytes, zero for root) | u32 nonce
+// The nonce comes last so a nonce search only has to rehash the tail.
+// Fields are written into an inline stack buffer; only oversized names/paths spill to the heap.
+class NodeMessage {
+public:
+    NodeMessage() = default;
+
+    NodeMessage(const NodeMessage&) = delete;
+    NodeMessage& operator=(const NodeMessage&) = delete;
+
+    void assign(std::string_view id, int index, std::int64_t timestamp,
+                std::string_view name, std::string_view path, NodeClass cls,
+                const Hash256& parentHash, std::uint32_t nonce) {
+        size_ = 0;
+        overflow_.clear();
+
+        putBytes(id);
+        putInt(static_cast<std::uint32_t>(index), 4);
+        putInt(static_cast<std::uint64_t>(timestamp), 8);
+        putBytes(name);
+        putBytes(path);
+        putInt(static_cast<std::uint8_t>(cls), 1);
+        put(parentHash.data(), parentHash.size());
+        putInt(nonce, 4);
+    }
+
+    void assign(const CandidateBlock& block, const Hash256& parentHash) {
+#ifdef _WIN32
+        const std::string path = block.filePath.string();
+#else
+        const std::string& path = block.filePath.native();
+#endif
+        assign(block.id, block.index, block.timestamp, block.name, path,
+               block.cls, parentHash, block.nonce);
+    }
+
+    const std::uint8_t* data() const { return overflow_.empty() ? inline_ : overflow_.data(); }
+    std::size_t size() const { return size_; }
+
+private:
+    static constexpr std::size_t kInline = 512;
+
+    std::uint8_t inline_[kInline];
+    std::size_t size_ = 0;
+    std::vector<std::uint8_t> overflow_;
+
+    void put(const void* p, std::size_t n) {
+        if (overflow_.empty() && size_ + n > kInline) {
+            overflow_.assign(inline_, inline_ + size_);
+        }
+        if (!overflow_.empty()) {
+            const auto* b = static_cast<const std::uint8_t*>(p);
+            overflow_.insert(overflow_.end(), b, b + n);
+        } else {
+            std::memcpy(inline_ + size_, p, n);
+        }
+        size_ += n;
+    }
+
+    void putInt(std::uint64_t v, std::size_t bytes) {
+        std::uint8_t buf[8];
+        for (std::size_t i = 0; i < bytes; ++i) {
+            buf[i] = static_cast<std::uint8_t>(v >> (i * 8));
+        }
+        put(buf, bytes);
+    }
+
+    void putBytes(std::string_view s) {
+        putInt(static_cast<std::uint32_t>(s.size()), 4);
+        put(s.data(), s.size());
+    }
+};
+
+// Number of nodes handed to the hash backend per batch during subtree verification
+constexpr std::size_t kVerifyBatch = 32;
+
+// Genesis root fields are fixed, so independently started nodes share the root hash
+// (2024-12-08 00:00:00 UTC; the root's nonce is 0)
+constexpr std::int64_t kGenesisTimestamp = 1733616000000;
+
+// Nonce spaces a mine() call searches (one timestamp each) before it gives up
+constexpr unsigned kMineRounds = 4;
+
+const Hash256 kZeroHash{};
+
+// Merkle aggregation (domain tags keep inner nodes and node aggregates apart)
+constexpr std::uint8_t kMerkleInner = 0x01;
+constexpr std::uint8_t kMerkleNode  = 0x02;
+
+Hash256 MerkleParent(const HashBackend& hasher, const Hash256& left, const Hash256& right) {
+    std::uint8_t buf[1 + 2 * sizeof(Hash256)];
+    buf[0] = kMerkleInner;
+    std::memcpy(buf + 1, left.data(), left.size());
+    std::memcpy(buf + 1 + left.size(), right.data(), right.size());
+    return hasher.hash(buf, sizeof(buf));
+}
+
+Hash256 NodeAggregate(const HashBackend& hasher, const Hash256& hash,
+                      std::uint32_t childCount, const Hash256& childRoot) {
+    std::uint8_t buf[1 + sizeof(Hash256) + 4 + sizeof(Hash256)];
+    buf[0] = kMerkleNode;
+    std::memcpy(buf + 1, hash.data(), hash.size());
+    for (std::size_t i = 0; i < 4; ++i) {
+        buf[1 + hash.size() + i] = static_cast<std::uint8_t>(childCount >> (i * 8));
+    }
+    std::memcpy(buf + 1 + hash.size() + 4, childRoot.data(), childRoot.size());
+    return hasher.hash(buf, sizeof(buf));
+}
+
+// Borrow a CandidateBlock's fields (the block must outlive the view)
+BlockView ViewOf(const CandidateBlock& block, const std::string& path) {
+    BlockView view;
+    view.id        = block.id;
+    view.index     = block.index;
+    view.timestamp = block.timestamp;
+    view.nonce     = block.nonce;
+    view.name      = block.name;
+    view.filePath  = path;
+    view.cls       = block.cls;
+    view.hash      = block.hash;
+    return view;
+}
+
+// Per-worker deque for work stealing: the owner pushes/pops at the back,
+// thieves take from the front (the oldest, usually largest subtrees)
+class StealQueue {
+public:
+    void push(NodeIndex slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(slot);
+    }
+
+    NodeIndex pop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) return kNoNode;
+        NodeIndex slot = tasks_.back();
+        tasks_.pop_back();
+        return slot;
+    }
+
+    NodeIndex steal() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) return kNoNode;
+        NodeIndex slot = tasks_.front();
+        tasks_.pop_front();
+        return slot;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<NodeIndex> tasks_;
+};
+
+template <typename T>
+std::size_t VectorBytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+// Whether `id` is `prefix` or extends it by whole '-' segments (PathIndex's notion of "under")
+bool IdUnder(std::string_view id, std::string_view prefix) {
+    return id.size() >= prefix.size() && id.compare(0, prefix.size(), prefix) == 0 &&
+           (id.size() == prefix.size() || id[prefix.size()] == '-');
+}
+
+bool StartsWith(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
 } // anonymous namespace
 
 // ---------------- NodeClass <-> String Conversion ----------------
@@ -31,7 +206,7 @@ std::string NodeClassToString(NodeClass cls) {
     return "unknown";
 }
 
-NodeClass NodeClassFromString(const std::string& s) {
+NodeClass NodeClassFromString(std::string_view s) {
     if (s == "big")   return NodeClass::Big;
     if (s == "child") return NodeClass::Child;
     if (s == "tiny")  return NodeClass::Tiny;
@@ -42,153 +217,944 @@ NodeClass NodeClassFromString(const std::string& s) {
 
 // ---------------- BlockTree Implementation ----------------
 
-BlockTree::BlockTree()
-    : rng_(std::random_device{}()) {
+BlockTree::BlockTree(const HashBackend& hasher)
+    : hasher_(&hasher),
+      rng_(std::random_device{}()) {
+
+    // Create unique root node (slot 0), identical on every node
+    BlockView root;
+    root.id        = "root";
+    root.timestamp = kGenesisTimestamp;
+    root.name      = "root";
+    root.cls       = NodeClass::Root;
+
+    const NodeIndex slot = allocate(kNoNode, root);
+    hash_[slot] = computeHash(slot, kZeroHash);
+    rootAggregate_ = computeAggregate(slot);
+    indexNode(slot, false);
+}
+
+NodeIndex BlockTree::allocate(NodeIndex parent, const BlockView& block) {
+    if (size() >= kNoNode) {
+        throw std::runtime_error("BlockTree is full");
+    }
+
+    const auto slot = static_cast<NodeIndex>(size());
+
+    ids_.push_back(strings_.append(block.id));
+    names_.push_back(strings_.intern(block.name));
+    paths_.push_back(strings_.intern(block.filePath));
+    index_.push_back(block.index);
+    timestamp_.push_back(block.timestamp);
+    nonce_.push_back(block.nonce);
+    cls_.push_back(block.cls);
+    hash_.push_back(block.hash);
+    parent_.push_back(parent);
+    firstChild_.push_back(kNoNode);
+    lastChild_.push_back(kNoNode);
+    nextSibling_.push_back(kNoNode);
+    verifiedEpoch_.push_back(0);
+    dirty_.push_back(1);
+    childPos_.push_back(0);
+    childTree_.push_back(kNoNode);
+
+    // Append to the parent's child list (keeps insertion order)
+    if (parent != kNoNode) {
+        if (lastChild_[parent] == kNoNode) {
+            firstChild_[parent] = slot;
+            childTree_[parent] = static_cast<std::uint32_t>(childTrees_.size());
+            childTrees_.emplace_back();
+        } else {
+            nextSibling_[lastChild_[parent]] = slot;
+            childPos_[slot] = childPos_[lastChild_[parent]] + 1;
+        }
+        lastChild_[parent] = slot;
+    }
+
+    idIndex_.insert(block.id, slot);
+    return slot;
+}
 
-    // Create unique root node
-    root_ = std::make_shared<Node>();
-    root_->id        = "root";
-    root_->index     = 0;
-    root_->timestamp = NowMs();
-    root_->nonce     = 0;
-    root_->name      = "root";
-    root_->filePath  = std::filesystem::path();
-    root_->cls       = NodeClass::Root;
-    root_->hash      = computeHash(*root_, "");
+void BlockTree::indexNode(NodeIndex slot, bool restoring) {
+    // The name key must be the pooled copy: it outlives the block it came from
+    secondary_.insert(slot, cls_[slot], timestamp_[slot], strings_.get(names_[slot]), restoring);
+}
 
-    nodes_.emplace(root_->id, root_);
+NodeIndex BlockTree::slotOf(std::string_view id) const {
+    return idIndex_.find(id);
 }
 
-std::shared_ptr<Node> BlockTree::addNode(const CandidateBlock& block) {
-    auto itParent = nodes_.find(block.parentId);
-    if (itParent == nodes_.end()) {
+NodeRef BlockTree::addNode(const CandidateBlock& block) {
+    const NodeIndex parent = slotOf(block.parentId);
+    if (parent == kNoNode) {
         throw std::runtime_error("Parent not found: " + block.parentId);
     }
+    if (slotOf(block.id) != kNoNode) {
+        throw std::runtime_error("Block already exists: " + block.id);
+    }
 
-    auto parent = itParent->second;
+    refreshAggregates();
+    secondary_.refresh();
+
+    const std::string path = block.filePath.string();
+    BlockView view = ViewOf(block, path);
+    view.timestamp = block.timestamp == 0 ? NowMs() : block.timestamp;
+    view.nonce     = block.nonce == 0 ? randomNonce() : block.nonce;
+    if (block.nonce == 0 && difficulty_ > 0) {
+        // A random nonce would not meet the target, and searching here would hold the
+        // commit lock for the whole search
+        throw std::runtime_error("Block needs a mined nonce at difficulty " +
+                                 std::to_string(difficulty_) + ": " + block.id);
+    }
 
-    auto node = std::make_shared<Node>();
-    node->id        = block.id;
-    node->index     = block.index;
-    node->timestamp = block.timestamp == 0 ? NowMs() : block.timestamp;
-    node->nonce     = block.nonce == 0 ? randomNonce() : block.nonce;
-    node->name      = block.name;
-    node->filePath  = block.filePath;
-    node->cls       = block.cls;
-    node->parent    = parent;
+    const NodeIndex slot = allocate(parent, view);
 
-    node->hash = computeHash(*node, parent->hash);
+    hash_[slot] = computeHash(slot, hash_[parent]);
 
-    parent->children.push_back(node);
-    nodes_.emplace(node->id, node);
+    markDirty(slot);
+    updateAggregates(slot);
+    indexNode(slot, false);
 
-    return node;
+    return NodeRef(this, slot);
 }
 
 bool BlockTree::miner(const CandidateBlock& block) const {
-    auto itParent = nodes_.find(block.parentId);
-    if (itParent == nodes_.end()) {
+    const NodeIndex parent = slotOf(block.parentId);
+    if (parent == kNoNode) {
         return false;
     }
 
-    auto parent = itParent->second;
+    // Cheap, and not part of the memoized verdict (the difficulty may change).
+    // Nonce 0 would be replaced by addNode, so it can never be what gets committed.
+    if (!NonceSearch::meetsDifficulty(block.hash, difficulty_) ||
+        (difficulty_ > 0 && block.nonce == 0)) {
+        return false;
+    }
 
-    Node temp;
-    temp.id        = block.id;
-    temp.index     = block.index;
-    temp.timestamp = block.timestamp;
-    temp.nonce     = block.nonce;
-    temp.name      = block.name;
-    temp.filePath  = block.filePath;
-    temp.cls       = block.cls;
+    NodeMessage message;
+    message.assign(block, hash_[parent]);
+    bool verdict = false;
+    if (minerCache_.lookup(block.hash, message.data(), message.size(), verdict)) {
+        return verdict;
+    }
 
-    const std::string expected = computeHash(temp, parent->hash);
-    return expected == block.hash;
+    verdict = hasher_->hash(message.data(), message.size()) == block.hash;
+    minerCache_.insert(block.hash, message.data(), message.size(), verdict);
+    return verdict;
 }
 
-bool BlockTree::verifyNodeAndAncestors(const std::string& id) const {
-    auto it = nodes_.find(id);
-    if (it == nodes_.end()) return false;
+NonceSearchResult BlockTree::mine(CandidateBlock& block, unsigned threads,
+                                  NonceSearch::Clock::time_point deadline) const {
+    const NodeIndex parent = slotOf(block.parentId);
+    if (parent == kNoNode) {
+        return NonceSearchResult{};
+    }
+    const Hash256 parentHash = hash_[parent];
+    return mine(block, parentHash, threads, deadline);
+}
 
-    std::shared_ptr<Node> current = it->second;
+NonceSearchResult BlockTree::mine(CandidateBlock& block, const Hash256& parentHash,
+                                  unsigned threads,
+                                  NonceSearch::Clock::time_point deadline) const {
+    if (block.timestamp == 0) block.timestamp = NowMs();
 
-    while (current) {
-        std::string parentHash;
-        if (auto parent = current->parent.lock()) {
-            parentHash = parent->hash;
+    NonceSearchResult result;
+    NodeMessage message;
+    for (unsigned round = 0; round < kMineRounds; ++round) {
+        block.nonce = 0;
+        message.assign(block, parentHash);
+        // Everything but the trailing nonce is fixed for the whole search
+        result = NonceSearch::run(*hasher_, message.data(), message.size() - 4, difficulty_,
+                                  std::random_device{}(), threads, deadline);
+        if (result.found) {
+            block.nonce = result.nonce;
+            block.hash  = result.hash;
+            return result;
         }
+        if (result.timedOut) break;
+        ++block.timestamp;
+    }
+    return result;
+}
 
-        const std::string expected = computeHash(*current, parentHash);
-        if (expected != current->hash) {
-            return false;
+bool BlockTree::sortBatch(std::vector<CandidateBlock>& blocks, std::string* error) const {
+    auto fail = [&](const std::string& msg) {
+        if (error) *error = msg;
+        return false;
+    };
+
+    std::unordered_map<std::string, std::size_t> position;
+    position.reserve(blocks.size());
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        if (slotOf(blocks[i].id) != kNoNode) {
+            return fail("Block already exists: " + blocks[i].id);
+        }
+        if (!position.emplace(blocks[i].id, i).second) {
+            return fail("Duplicate block in batch: " + blocks[i].id);
+        }
+    }
+
+    // Children lists inside the batch; blocks whose parent is already in the tree start the walk
+    std::vector<std::vector<std::size_t>> children(blocks.size());
+    std::vector<std::size_t> stack;
+    for (std::size_t i = blocks.size(); i-- > 0;) {
+        auto it = position.find(blocks[i].parentId);
+        if (it != position.end()) {
+            children[it->second].push_back(i);
+        } else if (slotOf(blocks[i].parentId) != kNoNode) {
+            stack.push_back(i);
+        } else {
+            return fail("Parent not found: " + blocks[i].parentId);
         }
+    }
 
-        if (current->cls == NodeClass::Root) {
-            break;
+    // DFS from tree-attached blocks; anything left unreached is part of a cycle
+    std::vector<CandidateBlock> sorted;
+    sorted.reserve(blocks.size());
+    std::vector<bool> placed(blocks.size(), false);
+    while (!stack.empty()) {
+        const std::size_t i = stack.back();
+        stack.pop_back();
+        placed[i] = true;
+        sorted.push_back(std::move(blocks[i]));
+        for (auto it = children[i].begin(); it != children[i].end(); ++it) {
+            stack.push_back(*it);
         }
+    }
 
-        current = current->parent.lock();
+    if (sorted.size() != blocks.size()) {
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            if (!placed[i]) return fail("Cyclic parent reference: " + blocks[i].id);
+        }
     }
 
+    blocks = std::move(sorted);
     return true;
 }
 
-bool BlockTree::verifySubTree(const std::string& id) const {
-    auto rootNode = findNode(id);
-    if (!rootNode) return false;
+bool BlockTree::minerBatch(const std::vector<CandidateBlock>& blocks, std::string* failedId,
+                           bool checkDifficulty) const {
+    // Claimed hashes of blocks seen so far (parents precede children after sortBatch)
+    std::unordered_map<std::string, const Hash256*> batchHashes;
+    batchHashes.reserve(blocks.size());
+
+    NodeMessage messages[kVerifyBatch];
+    const std::uint8_t* data[kVerifyBatch];
+    std::size_t lens[kVerifyBatch];
+    Hash256 hashes[kVerifyBatch];
+
+    for (std::size_t start = 0; start < blocks.size(); start += kVerifyBatch) {
+        const std::size_t count = std::min(kVerifyBatch, blocks.size() - start);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const CandidateBlock& block = blocks[start + i];
+            if (checkDifficulty && (!NonceSearch::meetsDifficulty(block.hash, difficulty_) ||
+                                    (difficulty_ > 0 && block.nonce == 0))) {
+                if (failedId) *failedId = block.id;
+                return false;
+            }
+
+            const Hash256* parentHash = nullptr;
+            auto inBatch = batchHashes.find(block.parentId);
+            if (inBatch != batchHashes.end()) {
+                parentHash = inBatch->second;
+            } else {
+                const NodeIndex parent = slotOf(block.parentId);
+                if (parent == kNoNode) {
+                    if (failedId) *failedId = block.id;
+                    return false;
+                }
+                parentHash = &hash_[parent];
+            }
+
+            messages[i].assign(block, *parentHash);
+            data[i] = messages[i].data();
+            lens[i] = messages[i].size();
+            batchHashes.emplace(block.id, &block.hash);
+        }
+
+        hasher_->hashMany(data, lens, count, hashes);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (hashes[i] != blocks[start + i].hash) {
+                if (failedId) *failedId = blocks[start + i].id;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+std::vector<NodeRef> BlockTree::addBatch(const std::vector<CandidateBlock>& blocks) {
+    // Validate everything up front so addNode cannot fail halfway through
+    std::unordered_set<std::string> pending;
+    pending.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        if (slotOf(block.id) != kNoNode || pending.count(block.id)) {
+            throw std::runtime_error("Duplicate block in batch: " + block.id);
+        }
+        if (slotOf(block.parentId) == kNoNode && !pending.count(block.parentId)) {
+            throw std::runtime_error("Parent not found: " + block.parentId);
+        }
+        pending.insert(block.id);
+    }
+
+    std::vector<NodeRef> added;
+    added.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        added.push_back(addNode(block));
+    }
+    return added;
+}
+
+bool BlockTree::verifyNodeAndAncestors(const std::string& id, VerifyMode mode) const {
+    NodeIndex current = slotOf(id);
+    if (current == kNoNode) return false;
+
+    ++verifyEpoch_;
+    lastVerifyHashCount_ = 0;
+
+    return verifyPath(current, mode) == kNoNode;
+}
+
+bool BlockTree::verifySubTree(const std::string& id, VerifyMode mode) const {
+    const NodeIndex rootSlot = slotOf(id);
+    if (rootSlot == kNoNode) return false;
 
     // First verify upward from current node to root
-    if (!verifyNodeAndAncestors(id)) return false;
+    if (!verifyNodeAndAncestors(id, mode)) return false;
 
-    // Then verify entire subtree downward via DFS
-    std::vector<std::shared_ptr<Node>> stack;
-    stack.push_back(rootNode);
+    // Then verify entire subtree downward via DFS.
+    // In incremental mode a clean subtree was fully verified by an earlier pass and is skipped.
+    // Nodes that need re-hashing are collected and hashed in batches.
+    std::vector<NodeIndex> stack;
+    std::vector<NodeIndex> visited;
+    NodeIndex batch[kVerifyBatch];
+    NodeIndex failed[kVerifyBatch];
+    std::size_t batchSize = 0;
+    stack.push_back(rootSlot);
 
     while (!stack.empty()) {
-        auto node = stack.back();
+        const NodeIndex slot = stack.back();
         stack.pop_back();
 
-        std::string parentHash;
-        if (auto parent = node->parent.lock()) {
-            parentHash = parent->hash;
-        }
+        if (mode == VerifyMode::Incremental && !dirty_[slot]) continue;
 
-        const std::string expected = computeHash(*node, parentHash);
-        if (expected != node->hash) return false;
+        if (mode == VerifyMode::Full || verifiedEpoch_[slot] == 0) {
+            batch[batchSize++] = slot;
+            if (batchSize == kVerifyBatch) {
+                lastVerifyHashCount_ += batchSize;
+                if (hashBatch(batch, batchSize, verifyEpoch_, failed) != 0) return false;
+                batchSize = 0;
+            }
+        }
+        visited.push_back(slot);
 
-        for (auto& child : node->children) {
+        for (NodeIndex child = firstChild_[slot]; child != kNoNode; child = nextSibling_[child]) {
             stack.push_back(child);
         }
     }
 
+    if (batchSize > 0) {
+        lastVerifyHashCount_ += batchSize;
+        if (hashBatch(batch, batchSize, verifyEpoch_, failed) != 0) return false;
+    }
+
+    // Only clear dirty markers once the whole subtree is known to be good,
+    // so a failed pass is retried in full next time.
+    for (NodeIndex slot : visited) {
+        dirty_[slot] = 0;
+    }
+
     return true;
 }
 
-std::shared_ptr<Node> BlockTree::findNode(const std::string& id) const {
-    auto it = nodes_.find(id);
-    if (it == nodes_.end()) return nullptr;
-    return it->second;
+VerifyReport BlockTree::verifySubTreeParallel(const std::string& id,
+                                              unsigned threads,
+                                              VerifyMode mode) const {
+    VerifyReport report;
+
+    const NodeIndex rootSlot = slotOf(id);
+    if (rootSlot == kNoNode) {
+        report.failedIds.push_back(id);
+        return report;
+    }
+
+    // The ancestor path is short; verify it serially first
+    ++verifyEpoch_;
+    lastVerifyHashCount_ = 0;
+    const NodeIndex bad = verifyPath(rootSlot, mode);
+    if (bad != kNoNode) {
+        report.nodesHashed = lastVerifyHashCount_;
+        report.failedIds.emplace_back(strings_.get(ids_[bad]));
+        return report;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const std::uint64_t epoch = verifyEpoch_;
+    std::vector<StealQueue> queues(threads);
+    std::vector<std::vector<NodeIndex>> visited(threads);
+    std::atomic<std::size_t> pending{1};    // Tasks pushed but not yet finished
+    std::atomic<std::size_t> hashed{0};
+    std::atomic<bool> stop{false};
+    std::mutex failedMutex;
+
+    queues[0].push(rootSlot);
+
+    auto worker = [&](unsigned self) {
+        NodeIndex batch[kVerifyBatch];
+        NodeIndex failed[kVerifyBatch];
+        std::size_t batchSize = 0;
+        std::size_t localHashed = 0;
+
+        auto flush = [&]() {
+            if (batchSize == 0) return;
+            localHashed += batchSize;
+            const std::size_t n = hashBatch(batch, batchSize, epoch, failed);
+            batchSize = 0;
+            if (n > 0) {
+                stop.store(true, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(failedMutex);
+                for (std::size_t i = 0; i < n; ++i) {
+                    report.failedIds.emplace_back(strings_.get(ids_[failed[i]]));
+                }
+            }
+        };
+
+        auto enqueueHash = [&](NodeIndex slot) {
+            if (mode == VerifyMode::Full || verifiedEpoch_[slot] == 0) {
+                batch[batchSize++] = slot;
+                if (batchSize == kVerifyBatch) flush();
+            }
+        };
+
+        while (pending.load(std::memory_order_acquire) > 0 &&
+               !stop.load(std::memory_order_relaxed)) {
+            NodeIndex slot = queues[self].pop();
+            for (unsigned i = 1; slot == kNoNode && i < threads; ++i) {
+                slot = queues[(self + i) % threads].steal();
+            }
+            if (slot == kNoNode) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // The subtree root was hashed by the ancestor check; its task only seeds
+            // the workers with its children
+            visited[self].push_back(slot);
+
+            // Inner children become stealable tasks; leaves are hashed in place
+            for (NodeIndex child = firstChild_[slot]; child != kNoNode; child = nextSibling_[child]) {
+                if (mode == VerifyMode::Incremental && !dirty_[child]) continue;
+                enqueueHash(child);
+                if (firstChild_[child] == kNoNode) {
+                    visited[self].push_back(child);
+                } else {
+                    pending.fetch_add(1, std::memory_order_relaxed);
+                    queues[self].push(child);
+                }
+                if (stop.load(std::memory_order_relaxed)) break;
+            }
+
+            flush();
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        flush();
+        hashed.fetch_add(localHashed, std::memory_order_relaxed);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& t : pool) t.join();
+
+    report.nodesHashed = lastVerifyHashCount_ + hashed.load();
+    lastVerifyHashCount_ = report.nodesHashed;
+    report.ok = report.failedIds.empty();
+
+    // Only clear dirty markers once the whole subtree is known to be good
+    if (report.ok) {
+        for (auto& list : visited) {
+            for (NodeIndex slot : list) dirty_[slot] = 0;
+        }
+    }
+
+    return report;
+}
+
+NodeRef BlockTree::restoreNode(const CandidateBlock& block) {
+    if (block.parentId.empty()) {
+        if (size() != 1) {
+            throw std::runtime_error("Root must be restored into an empty tree");
+        }
+
+        // Overwrite the genesis root in place
+        secondary_.erase(0, cls_[0], timestamp_[0], strings_.get(names_[0]));
+        idIndex_.clear();
+        ids_[0]       = strings_.append(block.id);
+        names_[0]     = strings_.intern(block.name);
+        paths_[0]     = strings_.intern(block.filePath.string());
+        index_[0]     = block.index;
+        timestamp_[0] = block.timestamp;
+        nonce_[0]     = block.nonce;
+        cls_[0]       = NodeClass::Root;
+        hash_[0]      = block.hash;
+        verifiedEpoch_[0] = 0;
+        dirty_[0]         = 1;
+        aggregatesStale_  = true;
+        minerCache_.clear();    // Verdicts against the old root no longer apply
+        idIndex_.insert(block.id, 0);
+        indexNode(0, true);
+        return root();
+    }
+
+    const NodeIndex parent = slotOf(block.parentId);
+    if (parent == kNoNode) {
+        throw std::runtime_error("Parent not found: " + block.parentId);
+    }
+    const std::string path = block.filePath.string();
+    return restoreNode(parent, ViewOf(block, path));
+}
+
+NodeRef BlockTree::restoreNode(NodeIndex parent, const BlockView& block) {
+    const NodeIndex existing = slotOf(block.id);
+    if (existing != kNoNode) {
+        return NodeRef(this, existing);
+    }
+    if (parent >= size()) {
+        throw std::runtime_error("Parent not found for block: " + std::string(block.id));
+    }
+
+    const NodeIndex slot = allocate(parent, block);
+
+    markDirty(slot);
+    aggregatesStale_ = true;
+    indexNode(slot, true);
+
+    return NodeRef(this, slot);
+}
+
+CandidateBlock BlockTree::toBlock(NodeRef node) {
+    CandidateBlock block;
+    block.id        = std::string(node.id());
+    if (NodeRef parent = node.parent()) {
+        block.parentId = std::string(parent.id());
+    }
+    block.index     = node.index();
+    block.timestamp = node.timestamp();
+    block.nonce     = node.nonce();
+    block.name      = std::string(node.name());
+    block.filePath  = std::filesystem::path(std::string(node.filePath()));
+    block.cls       = node.cls();
+    block.hash      = node.hash();
+    return block;
+}
+
+NodeRef BlockTree::findNode(std::string_view id) const {
+    return NodeRef(this, slotOf(id));
+}
+
+std::vector<NodeRef> BlockTree::findByPrefix(std::string_view prefix) const {
+    std::vector<NodeRef> result;
+    idIndex_.forEachUnder(prefix, [&](NodeIndex slot) {
+        result.emplace_back(this, slot);
+    });
+    return result;
+}
+
+bool BlockTree::query(const NodeQuery& q, QueryPage& page) const {
+    page = QueryPage{};
+    const std::size_t limit = std::max<std::size_t>(q.limit, 1);
+    using TimeEntry = SecondaryIndex::TimeEntry;
+    const auto& timeline = secondary_.timeline();
+    const auto& names = secondary_.names();
+
+    auto matches = [&](NodeIndex slot) {
+        return (!q.hasClass || cls_[slot] == q.cls) &&
+               (!q.hasSince || timestamp_[slot] >= q.since) &&
+               (!q.hasUntil || timestamp_[slot] < q.until) &&
+               (q.namePrefix.empty() || StartsWith(strings_.get(names_[slot]), q.namePrefix)) &&
+               (q.under.empty() || IdUnder(strings_.get(ids_[slot]), q.under));
+    };
+
+    // Consider one index entry; true once the page is full or the budget is spent
+    auto visit = [&](NodeIndex slot) {
+        ++page.scanned;
+        if (matches(slot)) page.nodes.emplace_back(this, slot);
+        if (page.nodes.size() < limit && page.scanned < kQueryScanBudget) return false;
+        page.next = page.by + ':' + std::to_string(slot);
+        return true;
+    };
+
+    // Timestamp range [lo, hi) in the timeline
+    auto timeBegin = [&]() {
+        return q.hasSince ? std::lower_bound(timeline.begin(), timeline.end(), TimeEntry{q.since, 0})
+                          : timeline.begin();
+    };
+    auto timeEnd = [&]() {
+        return q.hasUntil ? std::lower_bound(timeline.begin(), timeline.end(), TimeEntry{q.until, 0})
+                          : timeline.end();
+    };
+    auto nameBegin = [&]() { return names.lower_bound(q.namePrefix); };
+
+    // 1. Pick the driving index: the one with the fewest candidate entries, or the
+    //    cursor's (its position only means something in that index)
+    NodeIndex after = kNoNode;
+    if (!q.cursor.empty()) {
+        const std::size_t colon = q.cursor.find(':');
+        if (colon == std::string::npos) return false;
+        page.by = q.cursor.substr(0, colon);
+        try {
+            after = static_cast<NodeIndex>(std::stoul(q.cursor.substr(colon + 1)));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (after >= size()) return false;
+    } else {
+        std::size_t best = size();
+        page.by = "all";
+        if (q.hasClass && secondary_.byClass(q.cls).size() < best) {
+            best = secondary_.byClass(q.cls).size();
+            page.by = "class";
+        }
+        if ((q.hasSince || q.hasUntil) && secondary_.ready()) {
+            const auto lo = timeBegin(), hi = timeEnd();
+            const std::size_t n = lo < hi ? static_cast<std::size_t>(hi - lo) : 0;
+            if (n < best) {
+                best = n;
+                page.by = "time";
+            }
+        }
+        if (!q.namePrefix.empty()) {
+            // Count postings only until they stop being the better choice
+            std::size_t n = 0;
+            for (auto it = nameBegin();
+                 it != names.end() && StartsWith(it->first, q.namePrefix) && n < best; ++it) {
+                n += it->second.size();
+            }
+            if (n < best) {
+                best = n;
+                page.by = "name";
+            }
+        }
+        // The subtree has no cheap size; it drives only when the other indexes are weak
+        if (!q.under.empty() && best > kQueryScanBudget) page.by = "under";
+    }
+
+    // 2. Walk the driving index from the cursor
+    if (page.by == "all") {
+        for (NodeIndex slot = after == kNoNode ? 0 : after + 1; slot < size(); ++slot) {
+            if (visit(slot)) return true;
+        }
+    } else if (page.by == "class") {
+        if (!q.hasClass) return false;
+        const auto& slots = secondary_.byClass(q.cls);
+        auto it = after == kNoNode ? slots.begin() : std::upper_bound(slots.begin(), slots.end(), after);
+        for (; it != slots.end(); ++it) {
+            if (visit(*it)) return true;
+        }
+    } else if (page.by == "time") {
+        if (!(q.hasSince || q.hasUntil) || !secondary_.ready()) return false;
+        auto it = timeBegin();
+        const auto end = timeEnd();
+        if (after != kNoNode) {
+            it = std::max(it, std::upper_bound(timeline.begin(), timeline.end(),
+                                               TimeEntry{timestamp_[after], after}));
+        }
+        for (; it < end; ++it) {
+            if (visit(it->slot)) return true;
+        }
+    } else if (page.by == "name") {
+        if (q.namePrefix.empty()) return false;
+        auto it = nameBegin();
+        std::size_t skip = 0;
+        if (after != kNoNode) {
+            it = names.find(strings_.get(names_[after]));
+            if (it == names.end()) return false;
+            skip = static_cast<std::size_t>(
+                std::upper_bound(it->second.begin(), it->second.end(), after) - it->second.begin());
+        }
+        for (; it != names.end() && StartsWith(it->first, q.namePrefix); ++it, skip = 0) {
+            for (std::size_t i = skip; i < it->second.size(); ++i) {
+                if (visit(it->second[i])) return true;
+            }
+        }
+    } else if (page.by == "under") {
+        // Trie order (parents first), resumed at the cursor's node: a page walks only
+        // what it examines instead of collecting the whole subtree
+        if (q.under.empty()) return false;
+        const std::string_view from = after == kNoNode ? std::string_view() : strings_.get(ids_[after]);
+        bool full = false;
+        if (!idIndex_.forEachUnder(q.under, from, [&](NodeIndex slot) { return !(full = visit(slot)); })) {
+            return after == kNoNode;    // An unknown subtree is just empty
+        }
+        if (full) return true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::size_t BlockTree::memoryUsage() const {
+    std::size_t bytes = strings_.memoryUsage();
+    bytes += VectorBytes(ids_) + VectorBytes(names_) + VectorBytes(paths_) +
+             VectorBytes(index_) + VectorBytes(timestamp_) + VectorBytes(nonce_) +
+             VectorBytes(cls_) + VectorBytes(hash_) + VectorBytes(parent_) +
+             VectorBytes(firstChild_) + VectorBytes(lastChild_) + VectorBytes(nextSibling_) +
+             VectorBytes(verifiedEpoch_) + VectorBytes(dirty_) +
+             VectorBytes(childPos_) + VectorBytes(childTree_) + VectorBytes(childTrees_);
+    for (const ChildTree& tree : childTrees_) {
+        bytes += VectorBytes(tree.levels);
+        for (const auto& level : tree.levels) bytes += VectorBytes(level);
+    }
+    bytes += idIndex_.memoryUsage();
+    bytes += secondary_.memoryUsage();
+    return bytes;
+}
+
+std::array<std::size_t, 4> BlockTree::classCounts() const {
+    std::array<std::size_t, 4> counts{};
+    for (NodeClass cls : cls_) {
+        ++counts[static_cast<std::size_t>(cls)];
+    }
+    return counts;
+}
+
+const Hash256& BlockTree::parentHash(NodeIndex slot) const {
+    const NodeIndex parent = parent_[slot];
+    return parent == kNoNode ? kZeroHash : hash_[parent];
+}
+
+Hash256 BlockTree::computeHash(NodeIndex slot, const Hash256& parentHash) const {
+    NodeMessage message;
+    message.assign(strings_.get(ids_[slot]), index_[slot], timestamp_[slot],
+                   strings_.get(names_[slot]), strings_.get(paths_[slot]), cls_[slot],
+                   parentHash, nonce_[slot]);
+    return hasher_->hash(message.data(), message.size());
 }
 
-std::string BlockTree::computeHash(const Node& node, const std::string& parentHash) const {
-    std::ostringstream oss;
-    oss << node.id << '|'
-        << node.index << '|'
-        << node.timestamp << '|'
-        << node.nonce << '|'
-        << node.name << '|'
-        << node.filePath.string() << '|'
-        << NodeClassToString(node.cls) << '|'
-        << parentHash;
+NodeIndex BlockTree::verifyPath(NodeIndex slot, VerifyMode mode) const {
+    for (NodeIndex current = slot; current != kNoNode; current = parent_[current]) {
+        if (!verifyNode(current, mode)) {
+            return current;
+        }
+
+        if (cls_[current] == NodeClass::Root) {
+            break;
+        }
+    }
+
+    return kNoNode;
+}
+
+bool BlockTree::verifyNode(NodeIndex slot, VerifyMode mode) const {
+    // Nodes are immutable once added, so a hash verified once stays valid
+    if (mode == VerifyMode::Incremental && verifiedEpoch_[slot] != 0) {
+        return true;
+    }
+
+    ++lastVerifyHashCount_;
+    if (computeHash(slot, parentHash(slot)) != hash_[slot]) {
+        return false;
+    }
+
+    verifiedEpoch_[slot] = verifyEpoch_;
+    return true;
+}
+
+std::size_t BlockTree::hashBatch(const NodeIndex* slots, std::size_t count,
+                                 std::uint64_t epoch, NodeIndex* failed) const {
+    NodeMessage messages[kVerifyBatch];
+    const std::uint8_t* data[kVerifyBatch];
+    std::size_t lens[kVerifyBatch];
+    Hash256 hashes[kVerifyBatch];
 
-    const std::string data = oss.str();
-    const std::size_t h = std::hash<std::string>{}(data);
+    for (std::size_t i = 0; i < count; ++i) {
+        const NodeIndex slot = slots[i];
+        messages[i].assign(strings_.get(ids_[slot]), index_[slot], timestamp_[slot],
+                           strings_.get(names_[slot]), strings_.get(paths_[slot]), cls_[slot],
+                           parentHash(slot), nonce_[slot]);
+        data[i] = messages[i].data();
+        lens[i] = messages[i].size();
+    }
+
+    hasher_->hashMany(data, lens, count, hashes);
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (hashes[i] == hash_[slots[i]]) {
+            verifiedEpoch_[slots[i]] = epoch;
+        } else {
+            failed[mismatches++] = slots[i];
+        }
+    }
+    return mismatches;
+}
+
+void BlockTree::markDirty(NodeIndex slot) {
+    dirty_[slot] = 1;
+    verifiedEpoch_[slot] = 0;
+
+    // Every dirty node has dirty ancestors, so stop at the first one already marked
+    NodeIndex current = parent_[slot];
+    while (current != kNoNode && !dirty_[current]) {
+        dirty_[current] = 1;
+        current = parent_[current];
+    }
+}
+
+// ---------------- Merkle Aggregation ----------------
+
+std::uint32_t BlockTree::childCount(NodeIndex slot) const {
+    const std::uint32_t tree = childTree_[slot];
+    if (tree == kNoNode || childTrees_[tree].levels.empty()) return 0;
+    return static_cast<std::uint32_t>(childTrees_[tree].levels[0].size());
+}
+
+const Hash256& BlockTree::childRoot(NodeIndex slot) const {
+    const std::uint32_t tree = childTree_[slot];
+    if (tree == kNoNode || childTrees_[tree].levels.empty()) return kZeroHash;
+    return childTrees_[tree].levels.back()[0];
+}
 
-    std::ostringstream hex;
-    hex << std::hex << std::setw(sizeof(h) * 2)
-        << std::setfill('0') << h;
+Hash256 BlockTree::computeAggregate(NodeIndex slot) const {
+    return NodeAggregate(*hasher_, hash_[slot], childCount(slot), childRoot(slot));
+}
 
-    return hex.str();
+const Hash256& BlockTree::aggregateHash(NodeIndex slot) const {
+    const NodeIndex parent = parent_[slot];
+    if (parent == kNoNode) return rootAggregate_;
+    return childTrees_[childTree_[parent]].levels[0][childPos_[slot]];
+}
+
+void BlockTree::setChildAggregate(ChildTree& tree, std::size_t pos, const Hash256& value) {
+    if (tree.levels.empty()) tree.levels.emplace_back();
+    std::vector<Hash256>& leaves = tree.levels[0];
+    if (pos == leaves.size()) {
+        leaves.push_back(value);
+    } else {
+        leaves[pos] = value;
+    }
+
+    // Only the entries above `pos` change; children are append-only, so levels never shrink
+    for (std::size_t level = 0; tree.levels[level].size() > 1; ++level) {
+        if (level + 1 == tree.levels.size()) tree.levels.emplace_back();
+        const std::vector<Hash256>& below = tree.levels[level];
+        std::vector<Hash256>& above = tree.levels[level + 1];
+        above.resize((below.size() + 1) / 2);
+
+        const std::size_t left = pos & ~std::size_t(1);
+        above[pos / 2] = left + 1 < below.size()
+            ? MerkleParent(*hasher_, below[left], below[left + 1])
+            : below[left];
+        pos /= 2;
+    }
+}
+
+void BlockTree::updateAggregates(NodeIndex slot) {
+    Hash256 aggregate = computeAggregate(slot);
+    for (NodeIndex current = slot; parent_[current] != kNoNode; current = parent_[current]) {
+        const NodeIndex parent = parent_[current];
+        setChildAggregate(childTrees_[childTree_[parent]], childPos_[current], aggregate);
+        aggregate = computeAggregate(parent);
+    }
+    rootAggregate_ = aggregate;
+}
+
+void BlockTree::refreshAggregates() {
+    if (!aggregatesStale_) return;
+
+    for (std::size_t slot = 0; slot < size(); ++slot) {
+        if (childTree_[slot] == kNoNode) continue;
+        ChildTree& tree = childTrees_[childTree_[slot]];
+        tree.levels.resize(1);
+        tree.levels[0].assign(childPos_[lastChild_[slot]] + 1, kZeroHash);
+    }
+    // Children always sit in higher slots than their parent, so walking the arena
+    // backwards completes every child tree before its owner's aggregate is taken
+    for (std::size_t i = size(); i-- > 0;) {
+        const auto slot = static_cast<NodeIndex>(i);
+        if (childTree_[slot] != kNoNode) {
+            std::vector<std::vector<Hash256>>& levels = childTrees_[childTree_[slot]].levels;
+            while (levels.back().size() > 1) {
+                const std::vector<Hash256>& below = levels.back();
+                std::vector<Hash256> above((below.size() + 1) / 2);
+                for (std::size_t j = 0; j < above.size(); ++j) {
+                    above[j] = 2 * j + 1 < below.size()
+                        ? MerkleParent(*hasher_, below[2 * j], below[2 * j + 1])
+                        : below[2 * j];
+                }
+                levels.push_back(std::move(above));
+            }
+        }
+
+        const Hash256 aggregate = computeAggregate(slot);
+        const NodeIndex parent = parent_[slot];
+        if (parent == kNoNode) {
+            rootAggregate_ = aggregate;
+        } else {
+            childTrees_[childTree_[parent]].levels[0][childPos_[slot]] = aggregate;
+        }
+    }
+    aggregatesStale_ = false;
+}
+
+bool BlockTree::prove(std::string_view id, InclusionProof& proof) const {
+    const NodeIndex slot = slotOf(id);
+    if (slot == kNoNode) return false;
+
+    proof.levels.clear();
+    proof.childRoot = childRoot(slot);
+    proof.root = rootAggregate_;
+
+    InclusionProof::Level target;
+    target.id = std::string(id);
+    target.hash = hash_[slot];
+    target.childCount = childCount(slot);
+    proof.levels.push_back(std::move(target));
+
+    for (NodeIndex current = slot; parent_[current] != kNoNode; current = parent_[current]) {
+        const NodeIndex parent = parent_[current];
+        const ChildTree& tree = childTrees_[childTree_[parent]];
+
+        InclusionProof::Level level;
+        level.id = std::string(strings_.get(ids_[parent]));
+        level.hash = hash_[parent];
+        level.childCount = childCount(parent);
+        std::size_t pos = childPos_[current];
+        for (std::size_t l = 0; l + 1 < tree.levels.size(); ++l, pos /= 2) {
+            const std::size_t sibling = pos ^ 1;
+            if (sibling < tree.levels[l].size()) {
+                level.siblings.push_back(MerkleStep{sibling < pos, tree.levels[l][sibling]});
+            }
+        }
+        proof.levels.push_back(std::move(level));
+    }
+    return true;
+}
+
+bool BlockTree::verifyProof(const InclusionProof& proof, const HashBackend& hasher) {
+    if (proof.levels.empty()) return false;
+
+    const InclusionProof::Level& target = proof.levels[0];
+    Hash256 aggregate = NodeAggregate(hasher, target.hash, target.childCount, proof.childRoot);
+    for (std::size_t i = 1; i < proof.levels.size(); ++i) {
+        const InclusionProof::Level& level = proof.levels[i];
+        Hash256 current = aggregate;
+        for (const MerkleStep& step : level.siblings) {
+            current = step.left ? MerkleParent(hasher, step.hash, current)
+                                : MerkleParent(hasher, current, step.hash);
+        }
+        aggregate = NodeAggregate(hasher, level.hash, level.childCount, current);
+    }
+    return aggregate == proof.root;
 }
 
 std::uint32_t BlockTree::randomNonce() {
@@ -1,16 +1,24 @@
 // BlockTree.h
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <memory>
-#include <unordered_map>
 #include <filesystem>
 #include <cstdint>
 #include <random>
 
+#include "HashBackend.h"
+#include "MinerCache.h"
+#include "NonceSearch.h"
+#include "PathIndex.h"
+#include "SecondaryIndex.h"
+#include "StringPool.h"
+
 // Level 1: City Root Node / Big Object / Child Object / Tiny Object
-enum class NodeClass {
+enum class NodeClass : std::uint8_t {
     Root,
     Big,
     Child,
@@ -19,21 +27,46 @@ enum class NodeClass {
 
 // Utility function: Convert NodeClass to string for JSON / logging
 std::string NodeClassToString(NodeClass cls);
-NodeClass NodeClassFromString(const std::string& s);
-
-// A node in the block tree (corresponds to a "digital collection resource")
-struct Node {
-    std::string id;                     // Globally unique ID, e.g., "001-01-02"
-    int index = 0;                      // Index at current level
-    std::int64_t timestamp = 0;         // Timestamp in milliseconds
-    std::uint32_t nonce = 0;            // Random number for mining
-    std::string name;                   // Object name
-    std::filesystem::path filePath;     // Resource file path (FBX/GLTF etc.)
-    NodeClass cls = NodeClass::Big;     // big / child / tiny / root
-    std::string hash;                   // Current node's hash
-
-    std::weak_ptr<Node> parent;         // Parent node
-    std::vector<std::shared_ptr<Node>> children; // Child nodes
+NodeClass NodeClassFromString(std::string_view s);
+
+// Position of a node in the BlockTree arena (stable for the lifetime of the tree)
+using NodeIndex = std::uint32_t;
+constexpr NodeIndex kNoNode = 0xFFFFFFFFu;
+
+class BlockTree;
+
+// Lightweight handle to a node in the block tree (corresponds to a "digital collection resource").
+// Nodes are stored structure-of-arrays inside BlockTree; a NodeRef is just (tree, slot)
+// and stays valid as long as the tree does. A default-constructed NodeRef is "not found".
+class NodeRef {
+public:
+    class ChildIterator;
+    class ChildRange;
+
+    NodeRef() = default;
+    NodeRef(const BlockTree* tree, NodeIndex slot) : tree_(tree), slot_(slot) {}
+
+    explicit operator bool() const { return tree_ != nullptr && slot_ != kNoNode; }
+    bool operator==(const NodeRef& o) const { return tree_ == o.tree_ && slot_ == o.slot_; }
+    bool operator!=(const NodeRef& o) const { return !(*this == o); }
+
+    NodeIndex slot() const { return slot_; }
+
+    std::string_view id() const;        // Globally unique ID, e.g., "001-01-02"
+    int index() const;                  // Index at current level
+    std::int64_t timestamp() const;     // Timestamp in milliseconds
+    std::uint32_t nonce() const;        // Random number for mining
+    std::string_view name() const;      // Object name
+    std::string_view filePath() const;  // Resource file path (FBX/GLTF etc.)
+    NodeClass cls() const;              // big / child / tiny / root
+    const Hash256& hash() const;        // Current node's hash
+
+    NodeRef parent() const;             // Parent node (empty for the root)
+    ChildRange children() const;        // Child nodes, in insertion order
+
+private:
+    const BlockTree* tree_ = nullptr;
+    NodeIndex slot_ = kNoNode;
 };
 
 // "Candidate block" received from the network
@@ -46,40 +79,377 @@ struct CandidateBlock {
     std::string name;
     std::filesystem::path filePath;
     NodeClass cls = NodeClass::Big;
-    std::string hash;   // Hash computed by the client for comparison
+    Hash256 hash{};     // Hash computed by the client for comparison
+};
+
+// Non-owning view of a committed block's fields (used to restore nodes without copies)
+struct BlockView {
+    std::string_view id;
+    int index = 0;
+    std::int64_t timestamp = 0;
+    std::uint32_t nonce = 0;
+    std::string_view name;
+    std::string_view filePath;
+    NodeClass cls = NodeClass::Big;
+    Hash256 hash{};
+};
+
+// How much work a verification call is allowed to skip
+enum class VerifyMode {
+    Incremental,    // Only re-hash nodes added since the last successful pass
+    Full            // Re-hash every node regardless of cached state (audits)
+};
+
+// Result of a parallel verification pass
+struct VerifyReport {
+    bool ok = false;                    // True when every checked node matched
+    std::vector<std::string> failedIds; // Nodes whose stored hash did not match (or the missing id)
+    std::size_t nodesHashed = 0;        // Node hashes recomputed in this pass
+};
+
+// One sibling on the way from a child's aggregate up to its parent's children root
+struct MerkleStep {
+    bool left = false;      // Sibling sits on the left: parent = H(0x01 | sibling | current)
+    Hash256 hash{};
 };
 
-// Core of the tree-structured blockchain: Manages root node + subtree structure
+// Inclusion proof of one node against BlockTree::aggregateRoot() (see BlockTree::prove)
+struct InclusionProof {
+    struct Level {
+        std::string id;
+        Hash256 hash{};                     // The node's own block hash
+        std::uint32_t childCount = 0;
+        std::vector<MerkleStep> siblings;   // Path from the level below to this node's children root
+    };
+
+    Hash256 childRoot{};        // Children root of the proven node (zero when it has none)
+    std::vector<Level> levels;  // Proven node first (no siblings), then its ancestors up to the root
+    Hash256 root{};             // Aggregate root the proof was made against
+};
+
+// Filters of a "query"; unset filters match every node. Results come in pages of at
+// most `limit` nodes; pass a page's `next` back as `cursor` to continue.
+struct NodeQuery {
+    bool hasClass = false;
+    NodeClass cls = NodeClass::Root;
+    std::string namePrefix;         // Name starts with this (case-sensitive)
+    std::string under;              // ID is this one or below it (whole '-' segments)
+    bool hasSince = false;
+    std::int64_t since = 0;         // timestamp >= since (ms)
+    bool hasUntil = false;
+    std::int64_t until = 0;         // timestamp < until (ms)
+    std::size_t limit = 100;
+    std::string cursor;
+};
+
+struct QueryPage {
+    std::vector<NodeRef> nodes;
+    std::string next;               // Cursor of the following page (empty after the last)
+    std::string by;                 // Index that drove the scan: class, time, name, under or all
+    std::size_t scanned = 0;        // Index entries examined for this page
+};
+
+// Core of the tree-structured blockchain: Manages root node + subtree structure.
+// Node fields live in parallel arrays indexed by NodeIndex (slot 0 is the root);
+// children are linked first-child / next-sibling and strings are kept in a StringPool.
+// Lookups, miner checks and NodeRef accessors may run on many threads at once as long
+// as nothing is added meanwhile (see TreeLock); verification passes update per-node
+// caches and need the tree to themselves.
+//
+// Besides its own hash (which chains to the parent), every node has an aggregate
+//   H(0x02 | hash | u32 child count | children root)
+// where the children root is a binary Merkle tree over the children's aggregates in
+// insertion order (inner nodes H(0x01 | left | right), an unpaired last entry is carried
+// up unchanged). The root's aggregate therefore commits to the whole city. addNode
+// updates the aggregates along the new node's ancestor path, O(log fan-out) per level.
 class BlockTree {
 public:
-    BlockTree();
+    // The backend must outlive the tree; all nodes are hashed with it.
+    // Starts with the genesis root, whose fields (and so its hash) are the same everywhere.
+    explicit BlockTree(const HashBackend& hasher = DefaultHashBackend());
+
+    BlockTree(const BlockTree&) = delete;
+    BlockTree& operator=(const BlockTree&) = delete;
 
     // After consensus is reached, formally add the candidate block to the tree
-    std::shared_ptr<Node> addNode(const CandidateBlock& block);
+    NodeRef addNode(const CandidateBlock& block);
 
-    // Local "mining verification": Recalculate hash using the same rules and compare with block.hash
+    // Local "mining verification": Recalculate hash using the same rules and compare with block.hash.
+    // Verdicts are memoized (see MinerCache), so a repeated check of the same candidate
+    // against the same parent is answered without hashing.
     bool miner(const CandidateBlock& block) const;
 
+    // Proof-of-work target for new blocks: their hash must start with this many zero bits
+    // (0 = any hash, the default). miner() and minerBatch() enforce it; committed blocks
+    // are not re-checked, so it can be raised on a running chain. With a difficulty set,
+    // nonce 0 ("pick one") is refused: addNode never searches, the client mines first.
+    void setDifficulty(unsigned bits) { difficulty_ = std::min(bits, NonceSearch::kMaxDifficulty); }
+    unsigned difficulty() const { return difficulty_; }
+
+    // Search a nonce that makes `block` meet difficulty() (see NonceSearch), on `threads`
+    // cores (0 = all). Sets block.nonce and block.hash; a zero timestamp is stamped first,
+    // and bumped by a millisecond whenever the whole nonce space comes up empty. Gives up
+    // (result.timedOut) at `deadline`.
+    // The second form takes the parent's hash from the caller, so the search itself does
+    // not read the tree and needs no lock.
+    NonceSearchResult mine(CandidateBlock& block, unsigned threads = 0,
+                           NonceSearch::Clock::time_point deadline =
+                               NonceSearch::Clock::time_point::max()) const;
+    NonceSearchResult mine(CandidateBlock& block, const Hash256& parentHash,
+                           unsigned threads = 0,
+                           NonceSearch::Clock::time_point deadline =
+                               NonceSearch::Clock::time_point::max()) const;
+
+    // Maximum number of memoized miner verdicts (0 disables the cache)
+    void setMinerCacheCapacity(std::size_t entries) { minerCache_.setCapacity(entries); }
+    MinerCacheStats minerCacheStats() const { return minerCache_.stats(); }
+
+    // ---- Batches (a parent and its children may arrive together) ----
+
+    // Reorder a batch so every block comes after its parent. Parents may already be in the
+    // tree or appear in the batch. Fails on duplicate / existing IDs, unknown parents or cycles;
+    // `error` then names the offending block.
+    bool sortBatch(std::vector<CandidateBlock>& blocks, std::string* error = nullptr) const;
+
+    // Mining verification of a sorted batch. In-batch parents are checked against their
+    // claimed hashes, so the whole batch is hashed in bulk. `failedId` names the first bad block.
+    // Without `checkDifficulty` only the hashes are checked (history pulled from a replica
+    // may predate the current difficulty).
+    bool minerBatch(const std::vector<CandidateBlock>& blocks, std::string* failedId = nullptr,
+                    bool checkDifficulty = true) const;
+
+    // Commit a sorted, verified batch. All blocks are added, or none if validation fails.
+    std::vector<NodeRef> addBatch(const std::vector<CandidateBlock>& blocks);
+
     // Verify that the hash of the entire path from a node to the root is consistent
-    bool verifyNodeAndAncestors(const std::string& id) const;
+    bool verifyNodeAndAncestors(const std::string& id,
+                                VerifyMode mode = VerifyMode::Incremental) const;
+
+    // Verify the entire subtree rooted at a node (first upward, then downward).
+    // Incremental mode skips clean subtrees that were verified in an earlier pass.
+    bool verifySubTree(const std::string& id,
+                       VerifyMode mode = VerifyMode::Incremental) const;
+
+    // Same as verifySubTree, but the subtree is split at child boundaries across a
+    // work-stealing pool of `threads` workers (0 = hardware concurrency).
+    // All workers stop at the first mismatch; the failing node IDs are reported.
+    VerifyReport verifySubTreeParallel(const std::string& id,
+                                       unsigned threads = 0,
+                                       VerifyMode mode = VerifyMode::Incremental) const;
+
+    // Current verification epoch (incremented by every verification pass)
+    std::uint64_t verifyEpoch() const { return verifyEpoch_; }
+
+    // Number of node hashes recomputed by the most recent verification call
+    std::size_t lastVerifyHashCount() const { return lastVerifyHashCount_; }
+
+    // ---- Merkle aggregation ----
+
+    // Aggregate of the root: commits to every node in the tree
+    const Hash256& aggregateRoot() const { return rootAggregate_; }
+
+    // Aggregate of the subtree under a node
+    const Hash256& aggregateHash(NodeIndex slot) const;
+
+    // Inclusion proof for a node: its own fields plus, for each ancestor, the hash, child
+    // count and Merkle siblings needed to recompute aggregateRoot(). False if unknown.
+    bool prove(std::string_view id, InclusionProof& proof) const;
+
+    // Recompute the aggregate root from a proof and compare it with proof.root
+    static bool verifyProof(const InclusionProof& proof,
+                            const HashBackend& hasher = DefaultHashBackend());
 
-    // Verify the entire subtree rooted at a node (first upward, then downward)
-    bool verifySubTree(const std::string& id) const;
+    // Recompute every aggregate after restoreNode() calls (one bottom-up pass over the
+    // tree). No-op when nothing was restored; addNode calls it before its own update.
+    void refreshAggregates();
 
     // Get root node (unique block tree root)
-    std::shared_ptr<Node> root() const { return root_; }
+    NodeRef root() const { return NodeRef(this, 0); }
 
     // Find node by ID (for resource manager / business layer)
-    std::shared_ptr<Node> findNode(const std::string& id) const;
+    NodeRef findNode(std::string_view id) const;
+
+    // Every node whose ID is `prefix` or extends it by whole '-' segments
+    // (e.g. "001-01" -> the building and all its rooms / objects), parents first
+    std::vector<NodeRef> findByPrefix(std::string_view prefix) const;
+
+    // Nodes matching all of a query's filters, one page at a time. The scan is driven by
+    // the most selective index (class list, timestamp range, name prefix or ID subtree),
+    // the other filters are checked per entry, and one page examines at most
+    // kQueryScanBudget entries (a page may then come back short, with a cursor).
+    // Results are in the driving index's order. False if the cursor is not valid.
+    bool query(const NodeQuery& q, QueryPage& page) const;
+
+    static constexpr std::size_t kQueryScanBudget = 65536;
+
+    // Sort the secondary indexes after restoreNode() calls (addNode keeps them current)
+    void refreshIndexes() { secondary_.refresh(); }
+
+    // ID -> slot index (shared with ResourceManager, which keys its records by slot)
+    const PathIndex& idIndex() const { return idIndex_; }
+
+    // Handle for an arena slot (no bounds check beyond kNoNode)
+    NodeRef node(NodeIndex slot) const { return NodeRef(this, slot); }
+
+    // Number of nodes including the root
+    std::size_t size() const { return ids_.size(); }
+
+    // Approximate heap bytes used by node storage (arena arrays + string pool + ID and secondary indexes)
+    std::size_t memoryUsage() const;
+
+    // Node count per NodeClass, indexed by the enum value (root included)
+    std::array<std::size_t, 4> classCounts() const;
+
+    // ---- Persistence (used by BlockStore) ----
+
+    // Re-insert a block exactly as it was committed earlier: nonce, timestamp and hash are
+    // taken as-is (restored nodes are left dirty, so the next verification pass checks them).
+    // Aggregates are not updated per node; call refreshAggregates() once restoring is done.
+    // A block with an empty parentId replaces the genesis root; it must come first.
+    // Blocks that are already present are ignored (log replay is idempotent).
+    NodeRef restoreNode(const CandidateBlock& block);
+
+    // Same, with the parent given by slot (snapshot loading, no ID lookup or string copies)
+    NodeRef restoreNode(NodeIndex parent, const BlockView& block);
+
+    // The committed form of a node, suitable for logging and later restoreNode()
+    static CandidateBlock toBlock(NodeRef node);
+
+    // Hashing backend in use
+    const HashBackend& hasher() const { return *hasher_; }
 
 private:
-    std::shared_ptr<Node> root_;
-    std::unordered_map<std::string, std::shared_ptr<Node>> nodes_;
+    friend class NodeRef;
+
+    const HashBackend* hasher_;
+
+    // ---- Node arena (structure of arrays, indexed by NodeIndex) ----
+    StringPool strings_;
+    std::vector<StringPool::Ref> ids_;
+    std::vector<StringPool::Ref> names_;
+    std::vector<StringPool::Ref> paths_;
+    std::vector<std::int32_t>    index_;
+    std::vector<std::int64_t>    timestamp_;
+    std::vector<std::uint32_t>   nonce_;
+    std::vector<NodeClass>       cls_;
+    std::vector<Hash256>         hash_;
+    std::vector<NodeIndex>       parent_;
+    std::vector<NodeIndex>       firstChild_;
+    std::vector<NodeIndex>       lastChild_;
+    std::vector<NodeIndex>       nextSibling_;
+
+    // Verification cache (not part of the hash)
+    mutable std::vector<std::uint64_t> verifiedEpoch_;  // Epoch of the last successful check of the node's own hash (0 = never)
+    mutable std::vector<std::uint8_t>  dirty_;          // Node or a descendant added since the last verification pass
+
+    // Merkle aggregation: per-node Merkle tree over its children's aggregates.
+    // levels[0] holds the children's aggregates (the aggregate of a non-root node lives in
+    // its parent's levels[0]); the last level has a single entry, the children root.
+    struct ChildTree {
+        std::vector<std::vector<Hash256>> levels;
+    };
+    std::vector<std::uint32_t> childPos_;   // Position among the parent's children
+    std::vector<std::uint32_t> childTree_;  // Index into childTrees_ (kNoNode = no children)
+    std::vector<ChildTree>     childTrees_;
+    Hash256 rootAggregate_{};
+    bool aggregatesStale_ = false;          // Nodes were restored since the last refresh
+
+    // ID -> slot
+    PathIndex idIndex_;
+
+    // Class, timestamp and name indexes for query()
+    SecondaryIndex secondary_;
+
+    mutable MinerCache minerCache_;
+    unsigned difficulty_ = 0;
+
     mutable std::mt19937_64 rng_;
+    mutable std::uint64_t verifyEpoch_ = 0;
+    mutable std::size_t lastVerifyHashCount_ = 0;
+
+    // Append a node to the arena and link it under `parent` (kNoNode for the root)
+    NodeIndex allocate(NodeIndex parent, const BlockView& block);
+
+    // Add a slot to the secondary indexes (restores defer the timeline sort)
+    void indexNode(NodeIndex slot, bool restoring);
 
-    // Compute hash for a node (includes parent's hash)
-    std::string computeHash(const Node& node, const std::string& parentHash) const;
+    // Look up a slot by ID (kNoNode if absent)
+    NodeIndex slotOf(std::string_view id) const;
+
+    // Re-hash a single node against its parent's stored hash and record the epoch on success
+    bool verifyNode(NodeIndex slot, VerifyMode mode) const;
+
+    // Verify a node and its ancestors up to the root in the current epoch; returns the
+    // first node that fails, or kNoNode if the whole path is good
+    NodeIndex verifyPath(NodeIndex slot, VerifyMode mode) const;
+
+    // Re-hash a batch of nodes in one backend call (lets the backend use SIMD lanes).
+    // Returns the number of mismatches; mismatching slots are written to `failed`.
+    std::size_t hashBatch(const NodeIndex* slots, std::size_t count,
+                          std::uint64_t epoch, NodeIndex* failed) const;
+
+    // Push the dirty marker up the ancestor path of a newly added node
+    void markDirty(NodeIndex slot);
+
+    // Number of children / children root of a node (zero hash without children)
+    std::uint32_t childCount(NodeIndex slot) const;
+    const Hash256& childRoot(NodeIndex slot) const;
+
+    // H(0x02 | hash | child count | children root) for a node
+    Hash256 computeAggregate(NodeIndex slot) const;
+
+    // Store a child's aggregate in its parent's tree and re-hash the path above it
+    void setChildAggregate(ChildTree& tree, std::size_t pos, const Hash256& value);
+
+    // Recompute aggregates from a newly added node up to the root
+    void updateAggregates(NodeIndex slot);
+
+    // Hash of a node's parent (all zero for the root)
+    const Hash256& parentHash(NodeIndex slot) const;
+
+    // Compute hash for a stored node against the given parent hash
+    Hash256 computeHash(NodeIndex slot, const Hash256& parentHash) const;
 
     // Generate random nonce
     std::uint32_t randomNonce();
-};
\ No newline at end of file
+};
+
+// ---------------- NodeRef (inline accessors) ----------------
+
+class NodeRef::ChildIterator {
+public:
+    ChildIterator(const BlockTree* tree, NodeIndex slot) : tree_(tree), slot_(slot) {}
+    NodeRef operator*() const { return NodeRef(tree_, slot_); }
+    ChildIterator& operator++() { slot_ = tree_->nextSibling_[slot_]; return *this; }
+    bool operator!=(const ChildIterator& o) const { return slot_ != o.slot_; }
+
+private:
+    const BlockTree* tree_;
+    NodeIndex slot_;
+};
+
+class NodeRef::ChildRange {
+public:
+    ChildRange(const BlockTree* tree, NodeIndex first) : tree_(tree), first_(first) {}
+    ChildIterator begin() const { return ChildIterator(tree_, first_); }
+    ChildIterator end() const { return ChildIterator(tree_, kNoNode); }
+    bool empty() const { return first_ == kNoNode; }
+
+private:
+    const BlockTree* tree_;
+    NodeIndex first_;
+};
+
+inline std::string_view NodeRef::id() const        { return tree_->strings_.get(tree_->ids_[slot_]); }
+inline int NodeRef::index() const                  { return tree_->index_[slot_]; }
+inline std::int64_t NodeRef::timestamp() const     { return tree_->timestamp_[slot_]; }
+inline std::uint32_t NodeRef::nonce() const        { return tree_->nonce_[slot_]; }
+inline std::string_view NodeRef::name() const      { return tree_->strings_.get(tree_->names_[slot_]); }
+inline std::string_view NodeRef::filePath() const  { return tree_->strings_.get(tree_->paths_[slot_]); }
+inline NodeClass NodeRef::cls() const              { return tree_->cls_[slot_]; }
+inline const Hash256& NodeRef::hash() const        { return tree_->hash_[slot_]; }
+inline NodeRef NodeRef::parent() const             { return NodeRef(tree_, tree_->parent_[slot_]); }
+
+inline NodeRef::ChildRange NodeRef::children() const {
+    return ChildRange(tree_, tree_->firstChild_[slot_]);
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+// HashBackend.cpp
+#include "HashBackend.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+void PutNonce(std::uint8_t* p, std::uint32_t nonce) {
+    for (int i = 0; i < 4; ++i) p[i] = std::uint8_t(nonce >> (i * 8));
+}
+
+// Generic fallback: full candidate messages, hashed through the backend's hashMany
+class MessageNonceHasher : public NonceHasher {
+public:
+    MessageNonceHasher(const HashBackend& backend, const std::uint8_t* prefix, std::size_t len)
+        : backend_(backend), len_(len + 4) {
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            messages_[lane].assign(prefix, prefix + len);
+            messages_[lane].resize(len_);
+            data_[lane] = messages_[lane].data();
+            lens_[lane] = len_;
+        }
+    }
+
+    void hashNonces(std::uint32_t first, std::size_t count, Hash256* out) override {
+        for (std::size_t done = 0; done < count; done += kLanes) {
+            const std::size_t n = std::min(kLanes, count - done);
+            for (std::size_t lane = 0; lane < n; ++lane) {
+                PutNonce(messages_[lane].data() + len_ - 4,
+                         first + static_cast<std::uint32_t>(done + lane));
+            }
+            backend_.hashMany(data_, lens_, n, out + done);
+        }
+    }
+
+private:
+    static constexpr std::size_t kLanes = 8;
+
+    const HashBackend& backend_;
+    std::size_t len_;
+    std::vector<std::uint8_t> messages_[kLanes];
+    const std::uint8_t* data_[kLanes];
+    std::size_t lens_[kLanes];
+};
+
+// SHA-256: prefix absorbed once, candidates finished from the midstate
+class Sha256NonceHasher : public NonceHasher {
+public:
+    Sha256NonceHasher(Sha256Kernel kernel, const std::uint8_t* prefix, std::size_t len)
+        : midstate_(kernel), kernel_(kernel) {
+        midstate_.update(prefix, len);
+    }
+
+    void hashNonces(std::uint32_t first, std::size_t count, Hash256* out) override {
+        if (tails_.size() < count * 4) tails_.resize(count * 4);
+        for (std::size_t i = 0; i < count; ++i) {
+            PutNonce(tails_.data() + i * 4, first + static_cast<std::uint32_t>(i));
+        }
+        Sha256FinishMany(midstate_, tails_.data(), 4, count, out, kernel_);
+    }
+
+private:
+    Sha256 midstate_;
+    Sha256Kernel kernel_;
+    std::vector<std::uint8_t> tails_;
+};
+
+} // anonymous namespace
+
+void HashBackend::hashMany(const std::uint8_t* const* data, const std::size_t* lens,
+                           std::size_t count, Hash256* out) const {
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = hash(data[i], lens[i]);
+    }
+}
+
+std::unique_ptr<NonceHasher> HashBackend::nonceHasher(const std::uint8_t* prefix,
+                                                      std::size_t len) const {
+    return std::make_unique<MessageNonceHasher>(*this, prefix, len);
+}
+
+// ---------------- Sha256Backend ----------------
+
+Sha256Backend::Sha256Backend(Sha256Kernel kernel)
+    : kernel_(kernel) {}
+
+const char* Sha256Backend::name() const {
+    return Sha256KernelName(kernel_ == Sha256Kernel::Auto ? Sha256DetectKernel() : kernel_);
+}
+
+Hash256 Sha256Backend::hash(const std::uint8_t* data, std::size_t len) const {
+    return Sha256::hash(data, len, kernel_);
+}
+
+void Sha256Backend::hashMany(const std::uint8_t* const* data, const std::size_t* lens,
+                             std::size_t count, Hash256* out) const {
+    Sha256Many(data, lens, count, out, kernel_);
+}
+
+std::unique_ptr<NonceHasher> Sha256Backend::nonceHasher(const std::uint8_t* prefix,
+                                                        std::size_t len) const {
+    return std::make_unique<Sha256NonceHasher>(kernel_, prefix, len);
+}
+
+const HashBackend& DefaultHashBackend() {
+    static const Sha256Backend backend;
+    return backend;
+}
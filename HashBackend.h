@@ -0,0 +1,60 @@
+// HashBackend.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Sha256.h"
+
+// Hashes messages that share a fixed prefix and end in a u32 nonce (little-endian),
+// for the nonce search (see NonceSearch). Not thread-safe: one per search thread.
+class NonceHasher {
+public:
+    virtual ~NonceHasher() = default;
+
+    // Digests of prefix | first, prefix | first + 1, ... (`count` consecutive nonces, wrapping)
+    virtual void hashNonces(std::uint32_t first, std::size_t count, Hash256* out) = 0;
+};
+
+// Pluggable hashing backend used by BlockTree to hash serialized nodes
+class HashBackend {
+public:
+    virtual ~HashBackend() = default;
+
+    // Backend name for logging
+    virtual const char* name() const = 0;
+
+    // Hash one serialized node
+    virtual Hash256 hash(const std::uint8_t* data, std::size_t len) const = 0;
+
+    // Hash `count` independent serialized nodes (bulk verification / import).
+    // The default hashes them one by one; backends may override with SIMD batching.
+    virtual void hashMany(const std::uint8_t* const* data, const std::size_t* lens,
+                          std::size_t count, Hash256* out) const;
+
+    // Nonce hasher over a copy of `prefix`. The default builds every candidate message and
+    // hashes them with hashMany; backends may precompute the prefix state once instead.
+    virtual std::unique_ptr<NonceHasher> nonceHasher(const std::uint8_t* prefix,
+                                                     std::size_t len) const;
+};
+
+// SHA-256 backend (default): SHA-NI / portable per message, multi-buffer AVX2 for batches.
+// Its nonce hasher absorbs the prefix once and finishes candidates from that midstate.
+class Sha256Backend : public HashBackend {
+public:
+    explicit Sha256Backend(Sha256Kernel kernel = Sha256Kernel::Auto);
+
+    const char* name() const override;
+    Hash256 hash(const std::uint8_t* data, std::size_t len) const override;
+    void hashMany(const std::uint8_t* const* data, const std::size_t* lens,
+                  std::size_t count, Hash256* out) const override;
+    std::unique_ptr<NonceHasher> nonceHasher(const std::uint8_t* prefix,
+                                             std::size_t len) const override;
+
+private:
+    Sha256Kernel kernel_;
+};
+
+// Process-wide default backend (SHA-256, kernel auto-detected)
+const HashBackend& DefaultHashBackend();
@@ -0,0 +1,423 @@
+// LineServer.cpp
+#include "LineServer.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// epoll user data for the non-connection descriptors; connection IDs start above them
+constexpr std::uint64_t kWakeId        = 1;
+constexpr std::uint64_t kTcpListenId   = 2;
+constexpr std::uint64_t kUnixListenId  = 3;
+constexpr std::uint64_t kFirstConnId   = 16;
+
+constexpr std::size_t kReadChunk = 64 * 1024;
+constexpr int kMaxEvents = 256;
+
+bool AddFd(int epoll, int fd, std::uint64_t id, std::uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = id;
+    return ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+} // anonymous namespace
+
+LineServer::LineServer()
+    : nextConn_(kFirstConnId) {
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || wake_ < 0 || !AddFd(epoll_, wake_, kWakeId, EPOLLIN)) {
+        std::cerr << "[LineServer] epoll setup failed: " << std::strerror(errno) << '\n';
+    }
+}
+
+LineServer::~LineServer() {
+    stop();
+    if (tcpListener_ >= 0) ::close(tcpListener_);
+    if (unixListener_ >= 0) {
+        ::close(unixListener_);
+        ::unlink(unixPath_.c_str());
+    }
+    if (wake_ >= 0) ::close(wake_);
+    if (epoll_ >= 0) ::close(epoll_);
+}
+
+bool LineServer::listenTcp(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* res = nullptr;
+    const std::string service = std::to_string(port);
+    if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &res) != 0) {
+        std::cerr << "[LineServer] cannot resolve " << host << '\n';
+        return false;
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+
+    if (fd < 0 || !AddFd(epoll_, fd, kTcpListenId, EPOLLIN)) {
+        std::cerr << "[LineServer] cannot listen on " << host << ':' << port
+                  << ": " << std::strerror(errno) << '\n';
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    tcpListener_ = fd;
+    return true;
+}
+
+bool LineServer::listenUnix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[LineServer] socket path too long: " << path << '\n';
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    ::unlink(path.c_str());     // Stale socket from an earlier run
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0 ||
+        !AddFd(epoll_, fd, kUnixListenId, EPOLLIN)) {
+        std::cerr << "[LineServer] cannot listen on " << path << ": " << std::strerror(errno) << '\n';
+        ::close(fd);
+        return false;
+    }
+    unixListener_ = fd;
+    unixPath_ = path;
+    return true;
+}
+
+bool LineServer::start() {
+    if (thread_.joinable()) return true;
+    if (epoll_ < 0 || (tcpListener_ < 0 && unixListener_ < 0)) return false;
+    thread_ = std::thread([this]() { loop(); });
+    return true;
+}
+
+void LineServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    wake();
+    if (thread_.joinable()) thread_.join();
+
+    for (auto& kv : conns_) {
+        if (kv.second->fd >= 0) ::close(kv.second->fd);
+    }
+    conns_.clear();
+}
+
+void LineServer::wake() {
+    const std::uint64_t one = 1;
+    ssize_t n = ::write(wake_, &one, sizeof(one));
+    (void)n;
+}
+
+bool LineServer::nextBatch(std::deque<Line>& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_.wait(lock, [this]() { return stopping_ || !lines_.empty(); });
+    if (lines_.empty()) return false;
+    if (out.empty()) {
+        out.swap(lines_);
+    } else {
+        for (auto& line : lines_) out.push_back(std::move(line));
+        lines_.clear();
+    }
+    return true;
+}
+
+void LineServer::send(std::uint64_t id, std::string_view data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = conns_.find(id);
+    if (it == conns_.end() || it->second->fd < 0) return;
+
+    Connection& conn = *it->second;
+    if (conn.out.empty()) dirty_.push_back(id);
+    conn.out.append(data.data(), data.size());
+    conn.out.push_back('\n');
+    throttleLocked(id, conn);
+}
+
+void LineServer::done(std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = conns_.find(id);
+    if (it == conns_.end()) return;
+    if (it->second->inflight > 0) --it->second->inflight;
+    throttleLocked(id, *it->second);
+    maybeCloseLocked(id, *it->second);
+}
+
+void LineServer::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::uint64_t id : dirty_) {
+        auto it = conns_.find(id);
+        if (it == conns_.end()) continue;
+        Connection& conn = *it->second;
+        if (conn.wantWrite) continue;      // The I/O thread is already draining it
+
+        if (!writeLocked(id, conn)) {
+            toClose_.push_back(id);
+            wake();
+        } else if (!conn.out.empty()) {
+            // Socket buffer full: let the I/O thread finish when it becomes writable
+            conn.wantWrite = true;
+            armLocked(id, conn);
+        } else {
+            throttleLocked(id, conn);
+            maybeCloseLocked(id, conn);
+        }
+    }
+    dirty_.clear();
+}
+
+std::size_t LineServer::connections() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return conns_.size();
+}
+
+bool LineServer::writeLocked(std::uint64_t, Connection& conn) {
+    std::size_t written = 0;
+    while (written < conn.out.size()) {
+        const ssize_t n = ::send(conn.fd, conn.out.data() + written, conn.out.size() - written,
+                                 MSG_NOSIGNAL);
+        if (n > 0) {
+            written += static_cast<std::size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    conn.out.erase(0, written);
+    return true;
+}
+
+void LineServer::maybeCloseLocked(std::uint64_t id, const Connection& conn) {
+    if (conn.readClosed && conn.inflight == 0 && conn.out.empty() && conn.fd >= 0) {
+        toClose_.push_back(id);
+        wake();
+    }
+}
+
+void LineServer::loop() {
+    epoll_event events[kMaxEvents];
+
+    while (true) {
+        const int n = ::epoll_wait(epoll_, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[LineServer] epoll_wait failed: " << std::strerror(errno) << '\n';
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const std::uint64_t id = events[i].data.u64;
+            const std::uint32_t ev = events[i].events;
+
+            if (id == kWakeId) {
+                std::uint64_t count = 0;
+                ssize_t r = ::read(wake_, &count, sizeof(count));
+                (void)r;
+            } else if (id == kTcpListenId) {
+                accept(tcpListener_, true);
+            } else if (id == kUnixListenId) {
+                accept(unixListener_, false);
+            } else {
+                if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) readable(id);
+                if (ev & EPOLLOUT) writable(id);
+            }
+        }
+
+        std::vector<std::uint64_t> closing;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            closing.swap(toClose_);
+        }
+        for (std::uint64_t id : closing) close(id);
+    }
+}
+
+void LineServer::accept(int listener, bool tcp) {
+    while (true) {
+        const int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[LineServer] accept failed: " << std::strerror(errno) << '\n';
+            }
+            return;
+        }
+        if (tcp) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::uint64_t id = nextConn_++;
+        conns_.emplace(id, conn);
+        armLocked(id, *conn);
+    }
+}
+
+void LineServer::readable(std::uint64_t id) {
+    std::shared_ptr<Connection> conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = conns_.find(id);
+        if (it == conns_.end() || it->second->readClosed) return;
+        conn = it->second;
+    }
+
+    // Drain the socket, then split complete lines off the front of the buffer
+    bool eof = false;
+    bool error = false;
+    char buf[kReadChunk];
+    while (true) {
+        const ssize_t n = ::recv(conn->fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn->in.append(buf, static_cast<std::size_t>(n));
+            if (static_cast<std::size_t>(n) < sizeof(buf)) break;
+        } else if (n == 0) {
+            eof = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            error = errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+    }
+
+    std::vector<Line> batch;
+    std::size_t start = 0;
+    while (true) {
+        const std::size_t nl = conn->in.find('\n', start);
+        if (nl == std::string::npos) break;
+        std::size_t end = nl;
+        if (end > start && conn->in[end - 1] == '\r') --end;
+        if (end > start) {
+            batch.push_back(Line{id, conn->in.substr(start, end - start)});
+        }
+        start = nl + 1;
+    }
+    conn->in.erase(0, start);
+
+    if (conn->in.size() > kMaxLine) {
+        std::cerr << "[LineServer] request line too long, closing connection\n";
+        error = true;
+    }
+
+    if (error) {
+        close(id);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        conn->inflight += batch.size();
+        for (auto& line : batch) lines_.push_back(std::move(line));
+        throttleLocked(id, *conn);
+        if (eof) {
+            conn->readClosed = true;
+            armLocked(id, *conn);
+            maybeCloseLocked(id, *conn);
+        }
+    }
+    if (!batch.empty()) ready_.notify_one();
+}
+
+void LineServer::writable(std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = conns_.find(id);
+    if (it == conns_.end()) return;
+    Connection& conn = *it->second;
+
+    if (!writeLocked(id, conn)) {
+        toClose_.push_back(id);
+        return;
+    }
+    throttleLocked(id, conn);
+    if (conn.out.empty()) {
+        conn.wantWrite = false;
+        armLocked(id, conn);
+        maybeCloseLocked(id, conn);
+    }
+}
+
+void LineServer::armLocked(std::uint64_t id, Connection& conn) {
+    const std::uint32_t events = (conn.readClosed || conn.paused ? 0u : std::uint32_t(EPOLLIN)) |
+                                 (conn.wantWrite ? std::uint32_t(EPOLLOUT) : 0u);
+    if (events == 0) {
+        if (conn.polled) ::epoll_ctl(epoll_, EPOLL_CTL_DEL, conn.fd, nullptr);
+        conn.polled = false;
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = id;
+    ::epoll_ctl(epoll_, conn.polled ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, conn.fd, &ev);
+    conn.polled = true;
+}
+
+void LineServer::throttleLocked(std::uint64_t id, Connection& conn) {
+    if (conn.fd < 0) return;
+    if (!conn.paused) {
+        if (conn.inflight <= kMaxInflight && conn.out.size() <= kMaxPendingOut) return;
+        conn.paused = true;
+    } else {
+        // Resume at half the limits, so a busy client is not toggled on every response
+        if (conn.inflight > kMaxInflight / 2 || conn.out.size() > kMaxPendingOut / 2) return;
+        conn.paused = false;
+    }
+    armLocked(id, conn);
+}
+
+void LineServer::close(std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = conns_.find(id);
+    if (it == conns_.end()) return;
+    if (it->second->fd >= 0) {
+        if (it->second->polled) ::epoll_ctl(epoll_, EPOLL_CTL_DEL, it->second->fd, nullptr);
+        ::close(it->second->fd);
+        it->second->fd = -1;
+    }
+    conns_.erase(it);
+}
@@ -0,0 +1,123 @@
+// LineServer.h
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Newline-delimited request/response server on an epoll event loop (Linux).
+//
+// One I/O thread accepts persistent TCP and/or Unix-socket connections and reads
+// them non-blocking in large chunks; every complete line is queued for the consumer
+// (the node's event loop), many lines per wake-up. Clients may pipeline: responses
+// are buffered per connection and written back in order with as few write() calls
+// as possible. A connection whose client has shut down its write side stays open
+// until every request it sent has been answered.
+//
+// Backpressure: a connection with more than kMaxInflight unanswered lines, or more than
+// kMaxPendingOut bytes of responses its client has not read, is no longer read from
+// (EPOLLIN is dropped) until both are back under half the limit. A client that
+// pipelines without reading therefore stalls itself instead of growing the node's memory.
+class LineServer {
+public:
+    // One request line and the connection it came from
+    struct Line {
+        std::uint64_t conn;
+        std::string text;
+    };
+
+    LineServer();
+    ~LineServer();
+
+    LineServer(const LineServer&) = delete;
+    LineServer& operator=(const LineServer&) = delete;
+
+    // Listen on "host:port" (TCP) or a filesystem path (Unix socket). Call before start().
+    bool listenTcp(const std::string& host, std::uint16_t port);
+    bool listenUnix(const std::string& path);
+
+    // Spawn the I/O thread
+    bool start();
+
+    // Stop the I/O thread and close every connection (pending lines are dropped)
+    void stop();
+
+    // Block until lines are available, then move all of them into `out`.
+    // Returns false once the server is stopped.
+    bool nextBatch(std::deque<Line>& out);
+
+    // Queue a response line for a connection ('\n' is appended). Written on flush().
+    void send(std::uint64_t conn, std::string_view data);
+
+    // The consumer finished a request from `conn` (it may now be closed if the client is done)
+    void done(std::uint64_t conn);
+
+    // Write every queued response that the sockets accept without blocking; the I/O
+    // thread takes care of the rest when the sockets become writable
+    void flush();
+
+    std::size_t connections() const;
+
+    // Longest accepted request line; longer lines close the connection
+    static constexpr std::size_t kMaxLine = 64u << 20;
+
+    // Per-connection backpressure limits (see above)
+    static constexpr std::size_t kMaxInflight = 4096;
+    static constexpr std::size_t kMaxPendingOut = 4u << 20;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string in;             // Partial line (I/O thread only)
+        std::string out;            // Responses not yet written (mutex_)
+        std::size_t inflight = 0;   // Lines queued or being handled (mutex_)
+        bool readClosed = false;    // Client shut down its write side (mutex_)
+        bool paused = false;        // Not read from until the backlog drains (mutex_)
+        bool wantWrite = false;     // EPOLLOUT armed (mutex_)
+        bool polled = false;        // Registered with epoll (mutex_)
+    };
+
+    int epoll_ = -1;
+    int wake_ = -1;                 // eventfd: wakes the I/O thread
+    int tcpListener_ = -1;
+    int unixListener_ = -1;
+    std::string unixPath_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Line> lines_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<Connection>> conns_;
+    std::vector<std::uint64_t> dirty_;      // Connections with queued output
+    std::vector<std::uint64_t> toClose_;    // Connections the I/O thread should close
+    std::uint64_t nextConn_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void loop();
+    void accept(int listener, bool tcp);
+    void readable(std::uint64_t id);
+    void writable(std::uint64_t id);
+    void close(std::uint64_t id);
+
+    // Write as much of conn.out as possible; mutex_ must be held. False on a fatal error.
+    bool writeLocked(std::uint64_t id, Connection& conn);
+
+    // Close is due when the client is gone and nothing is left to answer; mutex_ must be held
+    void maybeCloseLocked(std::uint64_t id, const Connection& conn);
+
+    // Register the events this connection currently needs (none = leave the epoll set,
+    // so a hung-up peer does not keep waking the loop); mutex_ must be held
+    void armLocked(std::uint64_t id, Connection& conn);
+
+    // Pause reading a connection whose backlog passed the limits, resume it once drained;
+    // mutex_ must be held
+    void throttleLocked(std::uint64_t id, Connection& conn);
+    void wake();
+};
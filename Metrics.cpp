@@ -0,0 +1,165 @@
+// Metrics.cpp
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kMetrics = std::size_t(Metric::Count);
+constexpr std::size_t kCounters = std::size_t(Counter::Count);
+
+// One thread's counters. Only the owner writes (load + store, no read-modify-write);
+// atomics just make the concurrent reads in snapshot() well-defined.
+struct Shard {
+    std::array<std::array<std::atomic<std::uint64_t>, LatencyBuckets::kCount>, kMetrics> buckets;
+    std::array<std::atomic<std::uint64_t>, kMetrics> errors;
+    std::array<std::atomic<std::uint64_t>, kMetrics> sumNs;
+    std::array<std::atomic<std::uint64_t>, kMetrics> maxNs;
+    std::array<std::atomic<std::uint64_t>, kCounters> counters;
+};
+
+void Bump(std::atomic<std::uint64_t>& a, std::uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+// Never destroyed: threads may still record while static objects are torn down
+Registry& TheRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+Shard& LocalShard() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        Registry& registry = TheRegistry();
+        auto fresh = std::make_unique<Shard>();     // Value-initialized: all zero
+        shard = fresh.get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.shards.push_back(std::move(fresh));
+    }
+    return *shard;
+}
+
+} // namespace
+
+const char* MetricName(Metric metric) {
+    switch (metric) {
+        case Metric::Add:          return "add";
+        case Metric::AddMine:      return "add.mine";
+        case Metric::AddRemote:    return "add.remote";
+        case Metric::AddCommit:    return "add.commit";
+        case Metric::AddBatch:     return "add_batch";
+        case Metric::Check:        return "check";
+        case Metric::CheckBatch:   return "check_batch";
+        case Metric::ViewNode:     return "view_node";
+        case Metric::ViewBatch:    return "view_batch";
+        case Metric::Prove:        return "prove";
+        case Metric::Sync:         return "sync";
+        case Metric::Query:        return "query";
+        case Metric::Mine:         return "mine";
+        case Metric::ResourceLoad: return "resource.load";
+        case Metric::Count:        break;
+    }
+    return "unknown";
+}
+
+const char* CounterName(Counter counter) {
+    switch (counter) {
+        case Counter::Requests:    return "requests";
+        case Counter::FastDecoded: return "fast_decoded";
+        case Counter::InvalidJson: return "invalid_json";
+        case Counter::Count:       break;
+    }
+    return "unknown";
+}
+
+// ---------------- Buckets ----------------
+
+std::size_t LatencyBuckets::bucketOf(std::uint64_t ns) {
+    constexpr std::uint64_t kLinear = std::uint64_t(1) << kSubBits;
+    if (ns < kLinear) return static_cast<std::size_t>(ns);
+
+    const unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+    if (exponent >= kMaxExponent) return kCount - 1;
+
+    // Top kSubBits bits below the leading one select the sub-bucket
+    const unsigned shift = exponent - kSubBits;
+    const std::size_t group = exponent - kSubBits + 1;
+    return (group << kSubBits) + static_cast<std::size_t>((ns >> shift) - kLinear);
+}
+
+std::uint64_t LatencyBuckets::valueOf(std::size_t bucket) {
+    constexpr std::uint64_t kLinear = std::uint64_t(1) << kSubBits;
+    if (bucket < kLinear) return bucket;
+
+    const std::size_t group = bucket >> kSubBits;
+    const unsigned shift = static_cast<unsigned>(group) - 1;
+    const std::uint64_t low = (kLinear + (bucket & (kLinear - 1))) << shift;
+    return low + ((std::uint64_t(1) << shift) >> 1);
+}
+
+std::uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    const std::uint64_t rank =
+        std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * double(count) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(LatencyBuckets::valueOf(b), maxNs);
+    }
+    return maxNs;
+}
+
+// ---------------- Recording / Reading ----------------
+
+void Metrics::record(Metric metric, std::uint64_t ns, bool ok) {
+    Shard& shard = LocalShard();
+    const std::size_t m = std::size_t(metric);
+    Bump(shard.buckets[m][LatencyBuckets::bucketOf(ns)], 1);
+    Bump(shard.sumNs[m], ns);
+    if (!ok) Bump(shard.errors[m], 1);
+    if (ns > shard.maxNs[m].load(std::memory_order_relaxed)) {
+        shard.maxNs[m].store(ns, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::count(Counter counter, std::uint64_t n) {
+    Bump(LocalShard().counters[std::size_t(counter)], n);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot snap;
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (const auto& shard : registry.shards) {
+        for (std::size_t m = 0; m < kMetrics; ++m) {
+            HistogramSnapshot& h = snap.metrics[m];
+            for (std::size_t b = 0; b < LatencyBuckets::kCount; ++b) {
+                const std::uint64_t n = shard->buckets[m][b].load(std::memory_order_relaxed);
+                h.buckets[b] += n;
+                h.count += n;
+            }
+            h.errors += shard->errors[m].load(std::memory_order_relaxed);
+            h.sumNs += shard->sumNs[m].load(std::memory_order_relaxed);
+            h.maxNs = std::max(h.maxNs, shard->maxNs[m].load(std::memory_order_relaxed));
+        }
+        for (std::size_t c = 0; c < kCounters; ++c) {
+            snap.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    snap.uptimeSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - registry.start).count();
+    return snap;
+}
@@ -0,0 +1,113 @@
+// Metrics.h
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Latency histograms and counters for the request handlers.
+// Every thread records into its own shard with plain relaxed stores (no locks, no
+// shared cache lines); shards are merged only when someone reads them (the "stats"
+// mode), so instrumentation costs little more than the two clock reads of a timer.
+
+enum class Metric : std::uint8_t {
+    Add,            // Whole add request
+    AddMine,        //   local mining verification
+    AddRemote,      //   peer consensus round-trip
+    AddCommit,      //   tree commit + block log append
+    AddBatch,
+    Check,
+    CheckBatch,
+    ViewNode,
+    ViewBatch,
+    Prove,
+    Sync,           // Whole anti-entropy pull from a replica
+    Query,
+    Mine,           // Nonce search for a client's block
+    ResourceLoad,   // One resource file load (ResourceManager loader threads)
+    Count
+};
+
+enum class Counter : std::uint8_t {
+    Requests,       // Request lines taken by the event loop
+    FastDecoded,    // ... decoded by RequestDecoder
+    InvalidJson,    // ... rejected as malformed
+    Count
+};
+
+// "add", "add.mine", ... (keys of the stats response)
+const char* MetricName(Metric metric);
+const char* CounterName(Counter counter);
+
+// Log-linear bucketing of nanosecond latencies (HDR-style): values below 32 ns get
+// their own bucket, every power of two above is split into 32 equal buckets, so a
+// reported percentile is within ~3% of the true value. Values above ~68 s are clamped.
+struct LatencyBuckets {
+    static constexpr unsigned kSubBits = 5;
+    static constexpr unsigned kMaxExponent = 36;
+    static constexpr std::size_t kCount = std::size_t(kMaxExponent - kSubBits + 1) << kSubBits;
+
+    static std::size_t bucketOf(std::uint64_t ns);
+    static std::uint64_t valueOf(std::size_t bucket);   // Midpoint of the bucket's range
+};
+
+// Merged view of one metric
+struct HistogramSnapshot {
+    std::array<std::uint64_t, LatencyBuckets::kCount> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t errors = 0;       // Timed sections that reported failure
+    std::uint64_t sumNs = 0;
+    std::uint64_t maxNs = 0;
+
+    // Latency at quantile q (0..1), in nanoseconds; 0 when empty
+    std::uint64_t percentile(double q) const;
+    double meanNs() const { return count ? double(sumNs) / count : 0.0; }
+};
+
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, std::size_t(Metric::Count)> metrics;
+    std::array<std::uint64_t, std::size_t(Counter::Count)> counters{};
+    double uptimeSeconds = 0;
+
+    const HistogramSnapshot& operator[](Metric m) const { return metrics[std::size_t(m)]; }
+    std::uint64_t operator[](Counter c) const { return counters[std::size_t(c)]; }
+};
+
+class Metrics {
+public:
+    // Record one timed section of `ns` nanoseconds on the calling thread's shard
+    static void record(Metric metric, std::uint64_t ns, bool ok = true);
+
+    static void count(Counter counter, std::uint64_t n = 1);
+
+    // Merge every thread's shard (shards of finished threads are kept)
+    static MetricsSnapshot snapshot();
+
+    // Times a scope. done(ok) records and passes `ok` through; a timer that is never
+    // done (the section threw) records a failure.
+    class Timer {
+    public:
+        explicit Timer(Metric metric)
+            : metric_(metric), start_(std::chrono::steady_clock::now()) {}
+        ~Timer() {
+            if (!recorded_) done(false);
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool done(bool ok) {
+            recorded_ = true;
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            record(metric_, static_cast<std::uint64_t>(ns), ok);
+            return ok;
+        }
+
+    private:
+        Metric metric_;
+        std::chrono::steady_clock::time_point start_;
+        bool recorded_ = false;
+    };
+};
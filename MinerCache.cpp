@@ -0,0 +1,102 @@
+// MinerCache.cpp
+#include "MinerCache.h"
+
+#include <cstring>
+#include <random>
+
+std::size_t MinerCache::HashKey::operator()(const Hash256& h) const {
+    std::uint64_t v;
+    std::memcpy(&v, h.data(), sizeof(v));
+    v ^= seed;
+    v *= 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(v ^ (v >> 32));
+}
+
+MinerCache::MinerCache(std::size_t capacity)
+    : seed_(std::random_device{}() | (std::uint64_t(std::random_device{}()) << 32)) {
+    for (auto& shard : shards_) {
+        shard = std::make_unique<Shard>(seed_);
+    }
+    setCapacity(capacity);
+}
+
+MinerCache::Shard& MinerCache::shardOf(const Hash256& claimed) {
+    // Top bits pick the shard, so the buckets inside a shard still see varied low bits
+    return *shards_[(HashKey{seed_}(claimed) >> 56) % kShards];
+}
+
+bool MinerCache::lookup(const Hash256& claimed, const std::uint8_t* message, std::size_t len,
+                        bool& verdict) {
+    if (!enabled_.load(std::memory_order_relaxed)) return false;
+    Shard& shard = shardOf(claimed);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(claimed);
+    if (it == shard.index.end() || it->second->message.size() != len ||
+        std::memcmp(it->second->message.data(), message, len) != 0) {
+        ++shard.misses;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    verdict = it->second->verdict;
+    ++shard.hits;
+    return true;
+}
+
+void MinerCache::insert(const Hash256& claimed, const std::uint8_t* message, std::size_t len,
+                        bool verdict) {
+    if (!enabled_.load(std::memory_order_relaxed)) return;
+    Shard& shard = shardOf(claimed);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.capacity == 0) return;
+
+    // One entry per claimed hash: a different message claiming it replaces the old one
+    auto it = shard.index.find(claimed);
+    if (it != shard.index.end()) {
+        it->second->message.assign(message, message + len);
+        it->second->verdict = verdict;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.push_front(Entry{claimed, std::vector<std::uint8_t>(message, message + len), verdict});
+    shard.index.emplace(claimed, shard.lru.begin());
+    shard.trim();
+}
+
+void MinerCache::Shard::trim() {
+    while (lru.size() > capacity) {
+        index.erase(lru.back().claimed);
+        lru.pop_back();
+        ++evictions;
+    }
+}
+
+void MinerCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->lru.clear();
+    }
+}
+
+void MinerCache::setCapacity(std::size_t capacity) {
+    for (std::size_t i = 0; i < kShards; ++i) {
+        Shard& shard = *shards_[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.capacity = capacity / kShards + (i < capacity % kShards ? 1 : 0);
+        shard.trim();
+    }
+    enabled_.store(capacity > 0, std::memory_order_relaxed);
+}
+
+MinerCacheStats MinerCache::stats() const {
+    MinerCacheStats stats;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.entries += shard->lru.size();
+        stats.capacity += shard->capacity;
+    }
+    return stats;
+}
@@ -0,0 +1,92 @@
+// MinerCache.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Sha256.h"
+
+// Cache counters (summed over all shards)
+struct MinerCacheStats {
+    std::uint64_t hits = 0;         // Verdicts answered without hashing
+    std::uint64_t misses = 0;       // Verdicts that had to be hashed
+    std::uint64_t evictions = 0;    // Entries dropped to stay within the capacity
+    std::size_t entries = 0;
+    std::size_t capacity = 0;
+
+    double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+};
+
+// Bounded, concurrent memo of BlockTree::miner verdicts.
+//
+// Peers send the same candidate again and again (every peer asks, and retries), and
+// each check would re-hash it. Entries are keyed on the candidate's claimed hash and
+// keep the whole serialized message, which includes the parent's hash: a lookup only
+// hits when the bytes match exactly, so a forged block that reuses a valid claimed
+// hash, or a candidate whose parent has changed, misses and is hashed afresh.
+// Comparing ~100 bytes is much cheaper than a SHA-256.
+//
+// Entries are spread over independently locked shards, each an LRU list.
+class MinerCache {
+public:
+    explicit MinerCache(std::size_t capacity = 65536);
+
+    MinerCache(const MinerCache&) = delete;
+    MinerCache& operator=(const MinerCache&) = delete;
+
+    // Cached verdict for `message` claiming `claimed`; false on a miss
+    bool lookup(const Hash256& claimed, const std::uint8_t* message, std::size_t len,
+                bool& verdict);
+
+    // Remember a freshly computed verdict
+    void insert(const Hash256& claimed, const std::uint8_t* message, std::size_t len,
+                bool verdict);
+
+    // Drop every entry (counters are kept)
+    void clear();
+
+    // Maximum number of entries (0 disables the cache); shrinking evicts
+    void setCapacity(std::size_t capacity);
+
+    MinerCacheStats stats() const;
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct Entry {
+        Hash256 claimed;
+        std::vector<std::uint8_t> message;
+        bool verdict;
+    };
+
+    struct HashKey {
+        std::uint64_t seed;
+        std::size_t operator()(const Hash256& h) const;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;       // Most recently used first
+        std::unordered_map<Hash256, std::list<Entry>::iterator, HashKey> index;
+        std::size_t capacity = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+
+        explicit Shard(std::uint64_t seed) : index(0, HashKey{seed}) {}
+        void trim();
+    };
+
+    std::array<std::unique_ptr<Shard>, kShards> shards_;
+    std::atomic<bool> enabled_{false};  // Capacity above zero (skips the shard locks otherwise)
+    std::uint64_t seed_;            // Claimed hashes are chosen by clients; keep bucket choice secret
+
+    Shard& shardOf(const Hash256& claimed);
+};
@@ -0,0 +1,131 @@
+// NonceSearch.cpp
+#include "NonceSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+struct LevelCounters {
+    std::atomic<std::uint64_t> searches{0};
+    std::atomic<std::uint64_t> solved{0};
+    std::atomic<std::uint64_t> hashes{0};
+    std::atomic<std::uint64_t> nanoseconds{0};
+};
+
+LevelCounters g_levels[NonceSearch::kMaxDifficulty + 1];
+
+// Beyond this the ranges get too small to be worth a thread
+constexpr unsigned kMaxThreads = 256;
+
+// Batches between two clock reads (~1 ms of hashing on one core)
+constexpr unsigned kDeadlineEvery = 64;
+
+} // anonymous namespace
+
+bool NonceSearch::meetsDifficulty(const Hash256& hash, unsigned difficulty) {
+    difficulty = std::min<unsigned>(difficulty, hash.size() * 8);
+    const unsigned full = difficulty / 8;
+    for (unsigned i = 0; i < full; ++i) {
+        if (hash[i] != 0) return false;
+    }
+    const unsigned rest = difficulty % 8;
+    return rest == 0 || (hash[full] >> (8 - rest)) == 0;
+}
+
+NonceSearchResult NonceSearch::run(const HashBackend& hasher, const std::uint8_t* prefix,
+                                   std::size_t len, unsigned difficulty, std::uint32_t start,
+                                   unsigned threads, Clock::time_point deadline) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, kMaxThreads);
+    difficulty = std::min(difficulty, kMaxDifficulty);
+
+    NonceSearchResult result;
+    result.difficulty = difficulty;
+    result.threads = threads;
+
+    constexpr std::uint64_t kSpace = std::uint64_t(1) << 32;
+    const std::uint64_t chunk = kSpace / threads;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> expired{false};
+    const bool timed = deadline != Clock::time_point::max();
+    std::vector<std::uint64_t> hashed(threads, 0);
+
+    const auto begin = Clock::now();
+
+    auto worker = [&](unsigned t) {
+        std::unique_ptr<NonceHasher> nonces = hasher.nonceHasher(prefix, len);
+        const std::uint64_t first = t * chunk;
+        const std::uint64_t last = t + 1 == threads ? kSpace : first + chunk;
+        Hash256 out[kBatch];
+        std::uint64_t count = 0;
+        unsigned untilClock = kDeadlineEvery;
+
+        for (std::uint64_t offset = first; offset < last; offset += kBatch) {
+            if (stop.load(std::memory_order_relaxed)) break;
+            if (timed && --untilClock == 0) {
+                untilClock = kDeadlineEvery;
+                if (Clock::now() >= deadline) {
+                    expired.store(true, std::memory_order_relaxed);
+                    stop.store(true, std::memory_order_relaxed);
+                    break;
+                }
+            }
+            const std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(kBatch, last - offset));
+            const std::uint32_t base = start + static_cast<std::uint32_t>(offset);
+            nonces->hashNonces(base, n, out);
+            count += n;
+
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::uint32_t nonce = base + static_cast<std::uint32_t>(i);
+                if (nonce == 0 || !meetsDifficulty(out[i], difficulty)) continue;
+                // Only the first thread to get here reports; the others see `stop` next batch
+                if (!stop.exchange(true)) {
+                    result.found = true;
+                    result.nonce = nonce;
+                    result.hash = out[i];
+                }
+                break;
+            }
+        }
+        hashed[t] = count;
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& th : pool) th.join();
+
+    const auto elapsed = Clock::now() - begin;
+    result.timedOut = !result.found && expired.load(std::memory_order_relaxed);
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    for (std::uint64_t n : hashed) result.hashes += n;
+
+    LevelCounters& level = g_levels[difficulty];
+    level.searches.fetch_add(1, std::memory_order_relaxed);
+    level.solved.fetch_add(result.found ? 1 : 0, std::memory_order_relaxed);
+    level.hashes.fetch_add(result.hashes, std::memory_order_relaxed);
+    level.nanoseconds.fetch_add(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+        std::memory_order_relaxed);
+    return result;
+}
+
+std::vector<DifficultyStats> NonceSearch::stats() {
+    std::vector<DifficultyStats> out;
+    for (unsigned d = 0; d <= kMaxDifficulty; ++d) {
+        const LevelCounters& level = g_levels[d];
+        DifficultyStats s;
+        s.searches = level.searches.load(std::memory_order_relaxed);
+        if (s.searches == 0) continue;
+        s.difficulty = d;
+        s.solved = level.solved.load(std::memory_order_relaxed);
+        s.hashes = level.hashes.load(std::memory_order_relaxed);
+        s.seconds = double(level.nanoseconds.load(std::memory_order_relaxed)) / 1e9;
+        out.push_back(s);
+    }
+    return out;
+}
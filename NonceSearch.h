@@ -0,0 +1,66 @@
+// NonceSearch.h
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "HashBackend.h"
+
+// Outcome of one search
+struct NonceSearchResult {
+    bool found = false;
+    bool timedOut = false;          // Stopped at the deadline before a solution turned up
+    std::uint32_t nonce = 0;
+    Hash256 hash{};
+    unsigned difficulty = 0;
+    unsigned threads = 0;
+    std::uint64_t hashes = 0;       // Candidates hashed by all threads together
+    double seconds = 0;
+
+    double hashRate() const { return seconds > 0 ? double(hashes) / seconds : 0.0; }
+};
+
+// Totals of all searches at one difficulty (the "pow" part of the stats response)
+struct DifficultyStats {
+    unsigned difficulty = 0;
+    std::uint64_t searches = 0;
+    std::uint64_t solved = 0;
+    std::uint64_t hashes = 0;
+    double seconds = 0;
+
+    double hashRate() const { return seconds > 0 ? double(hashes) / seconds : 0.0; }
+};
+
+// Proof-of-work nonce search: finds a nonce for which H(prefix | u32 nonce) starts with
+// `difficulty` zero bits. The 32-bit nonce space is cut into one contiguous range per
+// thread; every thread hashes its range in batches of kBatch candidates through its own
+// NonceHasher (for SHA-256: the prefix state computed once, candidates finished eight at
+// a time in AVX2 lanes) and checks a shared flag between batches, so all threads stop
+// within one batch of the first solution. A deadline is checked every few thousand
+// candidates.
+//
+// Nonce 0 is never returned: for BlockTree it means "pick one for me".
+class NonceSearch {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A 2^32 nonce space rarely holds a solution beyond this
+    static constexpr unsigned kMaxDifficulty = 32;
+    static constexpr std::size_t kBatch = 64;
+
+    // Leading zero bits of the digest, counted from its first byte
+    static bool meetsDifficulty(const Hash256& hash, unsigned difficulty);
+
+    // Search the whole nonce space, starting at `start` (wrapping). `threads` 0 = one per
+    // core. Fails if no nonce in 2^32 reaches the difficulty (the caller then has to
+    // change the prefix, e.g. the timestamp) or, with `timedOut` set, at `deadline`.
+    static NonceSearchResult run(const HashBackend& hasher, const std::uint8_t* prefix,
+                                 std::size_t len, unsigned difficulty, std::uint32_t start,
+                                 unsigned threads = 0,
+                                 Clock::time_point deadline = Clock::time_point::max());
+
+    // Difficulties that have seen at least one search, in ascending order
+    static std::vector<DifficultyStats> stats();
+};
@@ -0,0 +1,256 @@
+// PathIndex.cpp
+#include "PathIndex.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr char kSeparator = '-';
+constexpr std::size_t kPackedMax = 7;
+constexpr std::uint64_t kLongTag = 0xFFull << 56;
+
+// Initial edge table capacity (power of two)
+constexpr std::size_t kInitialEdges = 64;
+
+std::size_t EdgeHash(std::uint64_t segment, std::uint32_t parent) {
+    std::uint64_t x = segment ^ (std::uint64_t(parent) * 0x9E3779B97F4A7C15ull);
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 29;
+    return static_cast<std::size_t>(x);
+}
+
+// Walks the '-'-separated segments of an ID in a single pass. Short segments are
+// packed into their table key while scanning (no memchr / memcpy per segment).
+class SegmentCursor {
+public:
+    explicit SegmentCursor(std::string_view id)
+        : p_(id.data()), end_(id.data() + id.size()) {}
+
+    // Advance to the next segment; false once the ID is exhausted
+    bool next() {
+        if (done_) return false;
+        const char* start = p_;
+        std::uint64_t packed = 0;
+        unsigned shift = 0;
+        while (p_ != end_ && *p_ != kSeparator) {
+            if (shift < 8 * kPackedMax) {
+                packed |= std::uint64_t(static_cast<std::uint8_t>(*p_)) << shift;
+                shift += 8;
+            }
+            ++p_;
+        }
+        segment_ = std::string_view(start, static_cast<std::size_t>(p_ - start));
+        packed_ = (std::uint64_t(segment_.size()) << 56) | packed;
+        if (p_ == end_) {
+            done_ = true;
+        } else {
+            ++p_;
+        }
+        return true;
+    }
+
+    std::string_view segment() const { return segment_; }
+    bool isShort() const { return segment_.size() <= kPackedMax; }
+    std::uint64_t packedKey() const { return packed_; }    // Only meaningful if isShort()
+
+private:
+    const char* p_;
+    const char* end_;
+    bool done_ = false;
+    std::string_view segment_;
+    std::uint64_t packed_ = 0;
+};
+
+} // anonymous namespace
+
+PathIndex::PathIndex() {
+    clear();
+}
+
+void PathIndex::clear() {
+    value_.assign(1, kNone);
+    firstChild_.assign(1, kNone);
+    lastChild_.assign(1, kNone);
+    nextSibling_.assign(1, kNone);
+    edges_.assign(kInitialEdges, Edge{});
+    edgeCount_ = 0;
+    size_ = 0;
+}
+
+bool PathIndex::longSegmentKey(std::string_view segment, std::uint64_t* key) const {
+    StringPool::Ref ref = 0;
+    if (!longSegments_.find(segment, &ref)) return false;
+    *key = kLongTag | ref;
+    return true;
+}
+
+const PathIndex::Edge* PathIndex::findEdge(TrieNode parent, std::uint64_t segment) const {
+    const std::size_t mask = edges_.size() - 1;
+    for (std::size_t i = EdgeHash(segment, parent) & mask;; i = (i + 1) & mask) {
+        const Edge& e = edges_[i];
+        if (e.child == kNone) return nullptr;
+        if (e.segment == segment && e.parent == parent) return &e;
+    }
+}
+
+PathIndex::Edge* PathIndex::addChild(TrieNode parent, std::uint64_t segment) {
+    if (const Edge* existing = findEdge(parent, segment)) {
+        return const_cast<Edge*>(existing);
+    }
+
+    // Keep the load factor under 3/4
+    if ((edgeCount_ + 1) * 4 > edges_.size() * 3) {
+        growEdges();
+    }
+
+    const auto node = static_cast<TrieNode>(value_.size());
+    value_.push_back(kNone);
+    firstChild_.push_back(kNone);
+    lastChild_.push_back(kNone);
+    nextSibling_.push_back(kNone);
+
+    if (lastChild_[parent] == kNone) {
+        firstChild_[parent] = node;
+    } else {
+        nextSibling_[lastChild_[parent]] = node;
+    }
+    lastChild_[parent] = node;
+
+    const std::size_t mask = edges_.size() - 1;
+    std::size_t i = EdgeHash(segment, parent) & mask;
+    while (edges_[i].child != kNone) i = (i + 1) & mask;
+    edges_[i] = Edge{segment, parent, node, kNone};
+    ++edgeCount_;
+    return &edges_[i];
+}
+
+void PathIndex::growEdges() {
+    std::vector<Edge> old(edges_.size() * 2, Edge{});
+    old.swap(edges_);
+
+    const std::size_t mask = edges_.size() - 1;
+    for (const Edge& e : old) {
+        if (e.child == kNone) continue;
+        std::size_t i = EdgeHash(e.segment, e.parent) & mask;
+        while (edges_[i].child != kNone) i = (i + 1) & mask;
+        edges_[i] = e;
+    }
+}
+
+const PathIndex::Edge* PathIndex::lookup(std::string_view id) const {
+    const Edge* edge = nullptr;
+    TrieNode node = kRoot;
+    SegmentCursor cursor(id);
+    while (cursor.next()) {
+        std::uint64_t key = cursor.packedKey();
+        if (!cursor.isShort() && !longSegmentKey(cursor.segment(), &key)) return nullptr;
+        edge = findEdge(node, key);
+        if (!edge) return nullptr;
+        node = edge->child;
+    }
+    return edge;
+}
+
+bool PathIndex::insert(std::string_view id, Value value) {
+    if (find(id) != kNone) return false;
+
+    TrieNode node = kRoot;
+    Edge* edge = nullptr;
+    SegmentCursor cursor(id);
+    while (cursor.next()) {
+        const std::uint64_t key = cursor.isShort()
+            ? cursor.packedKey()
+            : kLongTag | longSegments_.intern(cursor.segment());
+        edge = addChild(node, key);
+        node = edge->child;
+    }
+
+    value_[node] = value;
+    edge->value = value;
+    ++size_;
+    return true;
+}
+
+PathIndex::Value PathIndex::find(std::string_view id) const {
+    const Edge* edge = lookup(id);
+    return edge ? edge->value : kNone;
+}
+
+template <typename Fn>
+void PathIndex::walk(TrieNode start, TrieNode node, std::vector<TrieNode>& stack,
+                     bool visitNode, Fn&& fn) const {
+    while (true) {
+        if (visitNode && value_[node] != kNone && !fn(value_[node])) return;
+        visitNode = true;
+
+        const TrieNode next = node == start ? kNone : nextSibling_[node];
+        if (firstChild_[node] != kNone) {
+            if (next != kNone) stack.push_back(next);
+            node = firstChild_[node];
+        } else if (next != kNone) {
+            node = next;
+        } else if (!stack.empty()) {
+            node = stack.back();
+            stack.pop_back();
+        } else {
+            break;
+        }
+    }
+}
+
+void PathIndex::forEachUnder(std::string_view prefix,
+                             const std::function<void(Value)>& fn) const {
+    TrieNode start = kRoot;
+    if (!prefix.empty()) {
+        const Edge* edge = lookup(prefix);
+        if (!edge) return;
+        start = edge->child;
+    }
+
+    std::vector<TrieNode> stack;
+    walk(start, start, stack, true, [&](Value v) { fn(v); return true; });
+}
+
+bool PathIndex::forEachUnder(std::string_view prefix, std::string_view after,
+                             const std::function<bool(Value)>& fn) const {
+    TrieNode start = kRoot;
+    if (!prefix.empty()) {
+        const Edge* edge = lookup(prefix);
+        if (!edge) return false;
+        start = edge->child;
+    }
+
+    std::vector<TrieNode> stack;
+    if (after.empty()) {
+        walk(start, start, stack, true, fn);
+        return true;
+    }
+
+    // Rebuild the walk's state at `after`: the next sibling of every trie node on its
+    // path below `start`, shallowest first
+    TrieNode node = kRoot;
+    bool below = start == kRoot;
+    SegmentCursor cursor(after);
+    while (cursor.next()) {
+        if (below && node != start && nextSibling_[node] != kNone) {
+            stack.push_back(nextSibling_[node]);
+        }
+        std::uint64_t key = cursor.packedKey();
+        if (!cursor.isShort() && !longSegmentKey(cursor.segment(), &key)) return false;
+        const Edge* edge = findEdge(node, key);
+        if (!edge) return false;
+        node = edge->child;
+        below = below || node == start;
+    }
+    if (!below || value_[node] == kNone) return false;
+
+    walk(start, node, stack, false, fn);
+    return true;
+}
+
+std::size_t PathIndex::memoryUsage() const {
+    return value_.capacity() * sizeof(Value) +
+           (firstChild_.capacity() + lastChild_.capacity() + nextSibling_.capacity()) * sizeof(TrieNode) +
+           edges_.capacity() * sizeof(Edge) +
+           longSegments_.memoryUsage();
+}
@@ -0,0 +1,91 @@
+// PathIndex.h
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "StringPool.h"
+
+// Index from hierarchical IDs ("001-01-02") to 32-bit values (node slots).
+// IDs are split on '-' and stored as a trie of segments: each trie node is one
+// ID prefix, and edges live in an open-addressing table keyed by (parent, segment).
+// Segments of up to 7 bytes are packed into an integer key, longer ones are interned,
+// so a lookup is one integer probe per segment and never hashes the whole string.
+// All IDs under a prefix ("every node under building 001-01") can be listed
+// without scanning the rest of the index.
+class PathIndex {
+public:
+    using Value = std::uint32_t;
+    static constexpr Value kNone = 0xFFFFFFFFu;
+
+    PathIndex();
+
+    PathIndex(const PathIndex&) = delete;
+    PathIndex& operator=(const PathIndex&) = delete;
+
+    // Map `id` to `value`. Returns false (and changes nothing) if `id` is already present.
+    bool insert(std::string_view id, Value value);
+
+    // Value stored for `id`, or kNone
+    Value find(std::string_view id) const;
+
+    // Visit `prefix` itself and every ID that extends it by whole segments
+    // ("001-01" matches "001-01-02" but not "001-010"). Parents are visited before
+    // their children, siblings in insertion order. An empty prefix visits everything.
+    void forEachUnder(std::string_view prefix, const std::function<void(Value)>& fn) const;
+
+    // The same walk, resumable: starts just after the ID `after` (empty = at `prefix`) and
+    // stops as soon as `fn` returns false. Returns false if `prefix` or `after` is not
+    // stored or `after` is not under `prefix`.
+    bool forEachUnder(std::string_view prefix, std::string_view after,
+                      const std::function<bool(Value)>& fn) const;
+
+    // Number of IDs stored
+    std::size_t size() const { return size_; }
+
+    void clear();
+
+    // Approximate heap bytes held by the index
+    std::size_t memoryUsage() const;
+
+private:
+    using TrieNode = std::uint32_t;
+    static constexpr TrieNode kRoot = 0;
+
+    struct Edge {
+        std::uint64_t segment = 0;
+        TrieNode parent = 0;
+        TrieNode child = kNone;     // kNone = empty table slot
+        Value value = kNone;        // Copy of value_[child], so a hit needs no second load
+    };
+
+    // Trie nodes (structure of arrays); node 0 is the empty prefix
+    std::vector<Value>    value_;
+    std::vector<TrieNode> firstChild_;
+    std::vector<TrieNode> lastChild_;
+    std::vector<TrieNode> nextSibling_;
+
+    std::vector<Edge> edges_;       // Power-of-two capacity, linear probing
+    std::size_t edgeCount_ = 0;
+    std::size_t size_ = 0;
+
+    StringPool longSegments_;       // Segments that do not fit in a packed key
+
+    // Edge leading to the trie node of a full ID (null if any segment is missing)
+    const Edge* lookup(std::string_view id) const;
+
+    // Table key of a segment too long to pack. Returns false if it was never interned.
+    bool longSegmentKey(std::string_view segment, std::uint64_t* key) const;
+
+    // Pre-order walk of the trie under `start`, from `node` (visited first if `visitNode`);
+    // `stack` holds the next sibling to resume at each level below `start`
+    template <typename Fn>
+    void walk(TrieNode start, TrieNode node, std::vector<TrieNode>& stack, bool visitNode,
+              Fn&& fn) const;
+
+    const Edge* findEdge(TrieNode parent, std::uint64_t segment) const;
+    Edge* addChild(TrieNode parent, std::uint64_t segment);
+    void growEdges();
+};
@@ -0,0 +1,337 @@
+// PeerQuorum.cpp
+#include "PeerQuorum.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <numeric>
+#include <poll.h>
+#include <string_view>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr double kEwmaWeight = 0.2;         // Weight of the newest sample
+constexpr std::size_t kReadChunk = 4096;
+constexpr std::size_t kMaxAnswer = 64 * 1024;
+
+double Millis(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // anonymous namespace
+
+PeerQuorum::~PeerQuorum() {
+    for (Peer& peer : peers_) disconnect(peer);
+}
+
+// ---------------- Configuration ----------------
+
+bool PeerQuorum::addTcp(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = nullptr;
+    const std::string service = std::to_string(port);
+    if (::getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0 || !res) {
+        std::cerr << "[PeerQuorum] cannot resolve peer " << host << '\n';
+        return false;
+    }
+    const bool ok = add(host + ":" + service, res->ai_addr, res->ai_addrlen);
+    ::freeaddrinfo(res);
+    return ok;
+}
+
+bool PeerQuorum::addUnix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[PeerQuorum] socket path too long: " << path << '\n';
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return add(path, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+}
+
+bool PeerQuorum::add(const std::string& address, const sockaddr* addr, socklen_t len) {
+    std::lock_guard<std::mutex> round(roundMutex_);
+    std::lock_guard<std::mutex> info(infoMutex_);
+    Peer peer;
+    std::memcpy(&peer.addr, addr, len);
+    peer.addrLen = len;
+    peer.info.address = address;
+    peers_.push_back(std::move(peer));
+    return true;
+}
+
+std::vector<PeerQuorum::PeerInfo> PeerQuorum::peers() const {
+    std::lock_guard<std::mutex> lock(infoMutex_);
+    std::vector<PeerInfo> result;
+    result.reserve(peers_.size());
+    for (const Peer& peer : peers_) result.push_back(peer.info);
+    return result;
+}
+
+// ---------------- Consensus Round ----------------
+
+PeerQuorum::Result PeerQuorum::ask(const std::string& line) {
+    using Clock = std::chrono::steady_clock;
+    std::lock_guard<std::mutex> lock(roundMutex_);
+
+    Result result;
+    const unsigned total = static_cast<unsigned>(peers_.size());
+    if (total == 0) return result;
+    const unsigned need = quorum_ ? std::min(quorum_, total) : total / 2 + 1;
+    const unsigned initial = fanout_ ? std::min(total, std::max(fanout_, need)) : total;
+
+    // Fastest first; peers that never answered (EWMA 0) come first so they get measured
+    std::vector<std::size_t> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+        return peers_[a].info.ewmaMs < peers_[b].info.ewmaMs;
+    });
+
+    std::size_t next = 0;       // Position in `order` of the next peer to ask
+    unsigned inFlight = 0;
+
+    auto launch = [&]() {
+        Peer& peer = peers_[order[next++]];
+        ++result.asked;
+        if (send(peer, line)) {
+            peer.inFlight = true;
+            peer.sentAt = Clock::now();
+            ++inFlight;
+        } else {
+            sample(peer, Millis(timeout_));
+            ++result.failed;
+        }
+    };
+    auto fail = [&](Peer& peer, bool timedOut) {
+        {
+            std::lock_guard<std::mutex> info(infoMutex_);
+            ++(timedOut ? peer.info.timeouts : peer.info.errors);
+        }
+        sample(peer, Millis(timeout_));
+        disconnect(peer);
+        peer.inFlight = false;
+        --inFlight;
+        ++result.failed;
+    };
+
+    while (next < initial) launch();
+
+    std::vector<pollfd> fds;
+    std::vector<Peer*> polled;
+    while (result.yes < need) {
+        // Ask further peers while the ones outstanding can no longer make the quorum
+        while (result.yes + inFlight < need && next < total) launch();
+        if (result.yes + inFlight < need) break;
+
+        const auto now = Clock::now();
+        auto wait = std::chrono::duration_cast<Clock::duration>(timeout_);
+        fds.clear();
+        polled.clear();
+        for (Peer& peer : peers_) {
+            if (!peer.inFlight) continue;
+            const auto deadline = peer.sentAt + timeout_;
+            if (now >= deadline) {
+                std::cerr << "[PeerQuorum] peer " << peer.info.address << " timed out\n";
+                fail(peer, true);
+                continue;
+            }
+            wait = std::min(wait, deadline - now);
+            const short events = POLLIN | (peer.connecting || !peer.out.empty() ? POLLOUT : 0);
+            fds.push_back(pollfd{peer.fd, events, 0});
+            polled.push_back(&peer);
+        }
+        if (fds.empty()) continue;
+
+        const int ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()) + 1;
+        if (::poll(fds.data(), fds.size(), ms) < 0 && errno != EINTR) {
+            std::cerr << "[PeerQuorum] poll failed: " << std::strerror(errno) << '\n';
+            break;
+        }
+
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            Peer& peer = *polled[i];
+            const short revents = fds[i].revents;
+            if (revents == 0) continue;
+
+            if ((revents & (POLLOUT | POLLERR | POLLHUP)) && (peer.connecting || !peer.out.empty()) &&
+                !flushOut(peer)) {
+                fail(peer, false);
+                continue;
+            }
+            if (!(revents & (POLLIN | POLLERR | POLLHUP))) continue;
+
+            const Reply reply = receive(peer);
+            switch (reply) {
+            case Reply::Pending:
+                break;
+            case Reply::Yes:
+            case Reply::No:
+                sample(peer, Millis(Clock::now() - peer.sentAt));
+                {
+                    std::lock_guard<std::mutex> info(infoMutex_);
+                    ++peer.info.answers;
+                }
+                peer.inFlight = false;
+                --inFlight;
+                ++(reply == Reply::Yes ? result.yes : result.no);
+                break;
+            case Reply::Invalid:
+            case Reply::Broken:
+                fail(peer, false);
+                break;
+            }
+        }
+    }
+
+    // Early exit: answers still due are skipped at the start of the next round
+    for (Peer& peer : peers_) {
+        if (!peer.inFlight) continue;
+        peer.inFlight = false;
+        ++peer.stale;
+    }
+
+    result.agreed = result.yes >= need;
+    return result;
+}
+
+// ---------------- Peer I/O ----------------
+
+bool PeerQuorum::send(Peer& peer, const std::string& line) {
+    if (peer.fd < 0) {
+        const int family = peer.addr.ss_family;
+        peer.fd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (peer.fd < 0) return false;
+        if (family != AF_UNIX) {
+            int one = 1;
+            ::setsockopt(peer.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        if (::connect(peer.fd, reinterpret_cast<const sockaddr*>(&peer.addr), peer.addrLen) != 0) {
+            if (errno != EINPROGRESS) {
+                std::cerr << "[PeerQuorum] cannot connect to " << peer.info.address << ": "
+                          << std::strerror(errno) << '\n';
+                std::lock_guard<std::mutex> info(infoMutex_);
+                ++peer.info.errors;
+                disconnect(peer);
+                return false;
+            }
+            peer.connecting = true;
+        }
+    }
+
+    peer.out += line;
+    peer.out += '\n';
+    if (!peer.connecting && !flushOut(peer)) {
+        {
+            std::lock_guard<std::mutex> info(infoMutex_);
+            ++peer.info.errors;
+        }
+        disconnect(peer);
+        return false;
+    }
+    std::lock_guard<std::mutex> info(infoMutex_);
+    peer.info.connected = true;
+    return true;
+}
+
+bool PeerQuorum::flushOut(Peer& peer) {
+    if (peer.connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (::getsockopt(peer.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+            if (err == EINPROGRESS) return true;
+            std::cerr << "[PeerQuorum] cannot connect to " << peer.info.address << ": "
+                      << std::strerror(err ? err : errno) << '\n';
+            return false;
+        }
+        peer.connecting = false;
+    }
+    while (!peer.out.empty()) {
+        const ssize_t n = ::send(peer.fd, peer.out.data(), peer.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            peer.out.erase(0, static_cast<std::size_t>(n));
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+PeerQuorum::Reply PeerQuorum::receive(Peer& peer) {
+    char buf[kReadChunk];
+    bool closed = false;                // Closed by the peer, or a socket error
+    while (true) {
+        const ssize_t n = ::recv(peer.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            peer.in.append(buf, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closed = true;
+            break;
+        }
+    }
+
+    std::size_t begin = 0;
+    Reply reply = Reply::Pending;
+    for (std::size_t end; reply == Reply::Pending &&
+                          (end = peer.in.find('\n', begin)) != std::string::npos; begin = end + 1) {
+        if (peer.stale > 0) {
+            --peer.stale;               // Answer to a round that has already ended
+            continue;
+        }
+        // {"answer":true} / {"answer":false}; anything else ({"error":...}) is not a vote
+        const std::string_view line(peer.in.data() + begin, end - begin);
+        const std::size_t key = line.find("\"answer\"");
+        std::size_t value = key == std::string_view::npos ? key : line.find_first_not_of(" \t:", key + 8);
+        if (value != std::string_view::npos && line.compare(value, 4, "true") == 0) {
+            reply = Reply::Yes;
+        } else if (value != std::string_view::npos && line.compare(value, 5, "false") == 0) {
+            reply = Reply::No;
+        } else {
+            reply = Reply::Invalid;
+        }
+    }
+    peer.in.erase(0, begin);
+    if (closed) {
+        // An answer that arrived before the close still counts; the next round reconnects
+        if (reply == Reply::Pending) return Reply::Broken;
+        disconnect(peer);
+        return reply;
+    }
+    if (reply == Reply::Pending && peer.in.size() > kMaxAnswer) return Reply::Invalid;
+    return reply;
+}
+
+void PeerQuorum::disconnect(Peer& peer) {
+    if (peer.fd >= 0) ::close(peer.fd);
+    peer.fd = -1;
+    peer.connecting = false;
+    peer.out.clear();
+    peer.in.clear();
+    peer.stale = 0;
+    std::lock_guard<std::mutex> info(infoMutex_);
+    peer.info.connected = false;
+}
+
+void PeerQuorum::sample(Peer& peer, double ms) {
+    std::lock_guard<std::mutex> info(infoMutex_);
+    double& ewma = peer.info.ewmaMs;
+    ewma = ewma == 0 ? ms : kEwmaWeight * ms + (1 - kEwmaWeight) * ewma;
+}
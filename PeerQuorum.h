@@ -0,0 +1,111 @@
+// PeerQuorum.h
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+// Asks the other nodes of the consortium to check a block and waits for a quorum.
+//
+// Peers are nodes running the same binary with --listen / --unix; each keeps one
+// persistent connection and gets newline-delimited "check" / "check_batch" lines,
+// answered with {"answer": true/false}. A round writes the request to all chosen peers
+// at once and polls their sockets together, so its latency is that of the quorum-th
+// fastest answer rather than the sum. It returns as soon as `quorum` peers agree or so
+// many have said no (or failed) that agreement is impossible.
+//
+// Each peer has its own deadline; one that misses it counts as failed and is
+// disconnected (its late answer would be out of step). Answers that arrive after a round
+// has ended are skipped at the start of the next. Response times feed a per-peer EWMA:
+// with a fan-out below the peer count, the fastest peers are asked first and the
+// others only when an asked peer fails.
+class PeerQuorum {
+public:
+    struct Result {
+        bool agreed = false;
+        unsigned yes = 0;
+        unsigned no = 0;
+        unsigned failed = 0;        // Timed out, unreachable or answered with an error
+        unsigned asked = 0;
+    };
+
+    struct PeerInfo {
+        std::string address;
+        double ewmaMs = 0;          // 0 = no answer yet
+        std::uint64_t answers = 0;
+        std::uint64_t timeouts = 0;
+        std::uint64_t errors = 0;   // Connect / I/O failures and error replies
+        bool connected = false;
+    };
+
+    PeerQuorum() = default;
+    ~PeerQuorum();
+
+    PeerQuorum(const PeerQuorum&) = delete;
+    PeerQuorum& operator=(const PeerQuorum&) = delete;
+
+    // Add a peer by "host:port" (resolved now) or Unix socket path
+    bool addTcp(const std::string& host, std::uint16_t port);
+    bool addUnix(const std::string& path);
+
+    // Agreeing peers needed (0 = majority of the configured peers)
+    void setQuorum(unsigned quorum) { quorum_ = quorum; }
+
+    // Peers asked up front (0 = all); never fewer than the quorum
+    void setFanout(unsigned fanout) { fanout_ = fanout; }
+
+    // How long one peer may take to answer
+    void setTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
+    bool empty() const { return peers_.empty(); }
+
+    // One consensus round for `line` (no trailing newline). Rounds are serialized.
+    Result ask(const std::string& line);
+
+    std::vector<PeerInfo> peers() const;
+
+private:
+    enum class Reply { Pending, Yes, No, Invalid, Broken };
+
+    struct Peer {
+        sockaddr_storage addr{};
+        socklen_t addrLen = 0;
+        int fd = -1;
+        bool connecting = false;
+        std::string out;            // Bytes not yet written
+        std::string in;             // Partial answer line
+        unsigned stale = 0;         // Answers still due for requests of earlier rounds
+        PeerInfo info;              // infoMutex_ (written only by the round)
+
+        // Current round
+        bool inFlight = false;
+        std::chrono::steady_clock::time_point sentAt;
+    };
+
+    std::mutex roundMutex_;             // One round at a time; guards everything but `info`
+    mutable std::mutex infoMutex_;      // Lets peers() read while a round is waiting
+    std::vector<Peer> peers_;
+    unsigned quorum_ = 0;
+    unsigned fanout_ = 0;
+    std::chrono::milliseconds timeout_{2000};
+
+    bool add(const std::string& address, const sockaddr* addr, socklen_t len);
+
+    // Queue `line` for a peer, connecting first if needed; false if it cannot be reached
+    bool send(Peer& peer, const std::string& line);
+
+    // Complete a pending connect and write queued bytes; false on a fatal error
+    bool flushOut(Peer& peer);
+
+    // Read what the peer sent; the answer to the current round, if it has arrived
+    Reply receive(Peer& peer);
+
+    void disconnect(Peer& peer);
+
+    // Fold one response time (or the timeout, as a penalty) into the peer's EWMA
+    void sample(Peer& peer, double ms);
+};
@@ -0,0 +1,93 @@
+// Prefetcher.cpp
+#include "Prefetcher.h"
+
+#include <algorithm>
+
+void Prefetcher::bump(std::vector<Edge>& row, std::int64_t key) {
+    for (Edge& e : row) {
+        if (e.key == key) {
+            ++e.count;
+            return;
+        }
+    }
+    if (row.size() < kMaxEdges) {
+        row.push_back(Edge{key, 1});
+        return;
+    }
+    // Row full: the newcomer takes the weakest slot
+    auto weakest = std::min_element(row.begin(), row.end(),
+                                    [](const Edge& a, const Edge& b) { return a.count < b.count; });
+    *weakest = Edge{key, 1};
+}
+
+void Prefetcher::recordView(NodeRef node) {
+    if (!node) return;
+    const NodeIndex slot = node.slot();
+    const NodeIndex parent = node.parent() ? node.parent().slot() : kNoNode;
+
+    if (last_ != kNoNode && last_ != slot) {
+        bump(transitions_[last_], slot);
+
+        // A move between siblings also teaches the parent's index-delta table
+        if (parent != kNoNode && parent == lastParent_) {
+            bump(siblingDeltas_[parent], std::int64_t(node.index()) - lastIndex_);
+        }
+    }
+
+    last_ = slot;
+    lastParent_ = parent;
+    lastIndex_ = node.index();
+}
+
+std::vector<NodeIndex> Prefetcher::predict(NodeRef node, std::size_t count) const {
+    std::vector<NodeIndex> result;
+    if (!node || count == 0) return result;
+
+    // Candidate slot -> score; learned transitions weigh more than sibling-order guesses
+    std::vector<std::pair<NodeIndex, std::uint64_t>> scores;
+    auto add = [&](NodeIndex slot, std::uint64_t score) {
+        if (slot == node.slot()) return;
+        for (auto& s : scores) {
+            if (s.first == slot) {
+                s.second += score;
+                return;
+            }
+        }
+        scores.emplace_back(slot, score);
+    };
+
+    auto it = transitions_.find(node.slot());
+    if (it != transitions_.end()) {
+        for (const Edge& e : it->second) {
+            add(static_cast<NodeIndex>(e.key), 2 * std::uint64_t(e.count));
+        }
+    }
+
+    if (const NodeRef parent = node.parent()) {
+        auto deltas = siblingDeltas_.find(parent.slot());
+        if (deltas != siblingDeltas_.end()) {
+            for (NodeRef sibling : parent.children()) {
+                const std::int64_t delta = std::int64_t(sibling.index()) - node.index();
+                for (const Edge& e : deltas->second) {
+                    if (e.key == delta) add(sibling.slot(), e.count);
+                }
+            }
+        }
+    }
+
+    std::stable_sort(scores.begin(), scores.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    for (std::size_t i = 0; i < scores.size() && result.size() < count; ++i) {
+        result.push_back(scores[i].first);
+    }
+    return result;
+}
+
+void Prefetcher::clear() {
+    last_ = kNoNode;
+    lastParent_ = kNoNode;
+    lastIndex_ = 0;
+    transitions_.clear();
+    siblingDeltas_.clear();
+}
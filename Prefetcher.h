@@ -0,0 +1,43 @@
+// Prefetcher.h
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "BlockTree.h"
+
+// Learns how the player moves between viewed nodes and predicts the next ones.
+// Two Markov-style tables are kept:
+//   - transitions from each viewed node to the node viewed right after it
+//     (captures descents into rooms / cabinets and jumps between buildings);
+//   - per parent, how far the player moves along the sibling `index` between two
+//     views of children ("next room in order"), which also covers siblings never visited.
+// Not thread-safe; ResourceManager calls it under its own lock.
+class Prefetcher {
+public:
+    // Record that `node` is now in focus (the previous focus is the transition source)
+    void recordView(NodeRef node);
+
+    // Slots of up to `count` nodes most likely to be viewed after `node`, best first
+    std::vector<NodeIndex> predict(NodeRef node, std::size_t count) const;
+
+    // Forget the history (e.g. after a teleport / new session)
+    void clear();
+
+private:
+    static constexpr std::size_t kMaxEdges = 8;     // Per table row; the weakest entry is replaced
+
+    struct Edge {
+        std::int64_t key;       // Target slot (transitions) or index delta (siblings)
+        std::uint32_t count;
+    };
+
+    NodeIndex last_ = kNoNode;          // Previous focus
+    NodeIndex lastParent_ = kNoNode;
+    int lastIndex_ = 0;
+    std::unordered_map<NodeIndex, std::vector<Edge>> transitions_;     // From slot -> next slots
+    std::unordered_map<NodeIndex, std::vector<Edge>> siblingDeltas_;   // Parent slot -> index deltas
+
+    static void bump(std::vector<Edge>& row, std::int64_t key);
+};
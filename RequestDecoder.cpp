@@ -0,0 +1,250 @@
+// RequestDecoder.cpp
+#include "RequestDecoder.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace {
+
+// Forward-only reader over one JSON line. Every method returns false on input it
+// does not handle; the caller then gives the whole line to Poco.
+class Cursor {
+public:
+    explicit Cursor(std::string_view s) : p_(s.data()), end_(s.data() + s.size()) {}
+
+    void skipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    // Next non-space character ('\0' at the end)
+    char peek() {
+        skipSpace();
+        return p_ < end_ ? *p_ : '\0';
+    }
+
+    bool eat(char c) {
+        if (peek() != c) return false;
+        ++p_;
+        return true;
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return p_ == end_;
+    }
+
+    // "..." without escapes or control characters, as a view into the line
+    bool string(std::string_view& out) {
+        if (!eat('"')) return false;
+        const char* begin = p_;
+        while (p_ < end_) {
+            const unsigned char c = static_cast<unsigned char>(*p_);
+            if (c == '"') {
+                out = std::string_view(begin, static_cast<std::size_t>(p_ - begin));
+                ++p_;
+                return true;
+            }
+            if (c == '\\' || c < 0x20) return false;
+            ++p_;
+        }
+        return false;
+    }
+
+    // JSON integer that fits in int64 (fractions / exponents are left to Poco)
+    bool integer(std::int64_t& out) {
+        skipSpace();
+        const bool negative = p_ < end_ && *p_ == '-';
+        if (negative) ++p_;
+
+        const char* digits = p_;
+        std::uint64_t value = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+            if (value > (std::numeric_limits<std::uint64_t>::max() - 9) / 10) return false;
+            value = value * 10 + static_cast<std::uint64_t>(*p_ - '0');
+            ++p_;
+        }
+        if (p_ == digits) return false;
+        if (*digits == '0' && p_ - digits > 1) return false;    // Leading zeros are not JSON
+        if (p_ < end_ && (*p_ == '.' || *p_ == 'e' || *p_ == 'E')) return false;
+
+        constexpr std::uint64_t kMax = std::numeric_limits<std::int64_t>::max();
+        if (value > kMax + (negative ? 1 : 0)) return false;
+        out = negative ? static_cast<std::int64_t>(0 - value) : static_cast<std::int64_t>(value);
+        return true;
+    }
+
+    // Value of a field we do not use: any scalar is fine, nested values are not
+    bool skipScalar() {
+        std::string_view s;
+        switch (peek()) {
+        case '"': return string(s);
+        case 't': return word("true");
+        case 'f': return word("false");
+        case 'n': return word("null");
+        default:  return number();
+        }
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+
+    bool word(std::string_view w) {
+        if (static_cast<std::size_t>(end_ - p_) < w.size() ||
+            std::memcmp(p_, w.data(), w.size()) != 0) {
+            return false;
+        }
+        p_ += w.size();
+        return true;
+    }
+
+    // -?int(.digits)?([eE][+-]?digits)?
+    bool number() {
+        if (p_ < end_ && *p_ == '-') ++p_;
+        if (!digits(true)) return false;
+        if (p_ < end_ && *p_ == '.') {
+            ++p_;
+            if (!digits(false)) return false;
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            ++p_;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+            if (!digits(false)) return false;
+        }
+        return true;
+    }
+
+    bool digits(bool integerPart) {
+        const char* begin = p_;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') ++p_;
+        if (p_ == begin) return false;
+        return !integerPart || *begin != '0' || p_ - begin == 1;
+    }
+};
+
+enum class Field { Mode, Id, ParentId, Index, Timestamp, Rand, Name, Ele, Class, Hash, Other };
+
+Field FieldOf(std::string_view key) {
+    switch (key.size()) {
+    case 2: if (key == "id") return Field::Id; break;
+    case 3: if (key == "ele") return Field::Ele; break;
+    case 4:
+        if (key == "mode") return Field::Mode;
+        if (key == "name") return Field::Name;
+        if (key == "rand") return Field::Rand;
+        if (key == "hash") return Field::Hash;
+        break;
+    case 5:
+        if (key == "index") return Field::Index;
+        if (key == "class") return Field::Class;
+        break;
+    case 9:
+        if (key == "parent_id") return Field::ParentId;
+        if (key == "timestamp") return Field::Timestamp;
+        break;
+    default: break;
+    }
+    return Field::Other;
+}
+
+} // namespace
+
+// ---------------- Fast Path ----------------
+
+bool DecodeRequest(std::string_view line, RequestView& out) {
+    out = RequestView{};
+    Cursor in(line);
+    if (!in.eat('{')) return false;
+
+    if (!in.eat('}')) {
+        do {
+            std::string_view key;
+            if (!in.string(key) || !in.eat(':')) return false;
+
+            std::int64_t number = 0;
+            switch (FieldOf(key)) {
+            case Field::Mode:     if (!in.string(out.mode)) return false; break;
+            case Field::Id:       if (!in.string(out.id)) return false; break;
+            case Field::ParentId: if (!in.string(out.parentId)) return false; break;
+            case Field::Name:     if (!in.string(out.name)) return false; break;
+            case Field::Ele:      if (!in.string(out.ele)) return false; break;
+            case Field::Class:    if (!in.string(out.cls)) return false; break;
+            case Field::Hash:     if (!in.string(out.hash)) return false; break;
+            case Field::Index:
+                if (!in.integer(number) ||
+                    number < std::numeric_limits<int>::min() ||
+                    number > std::numeric_limits<int>::max()) {
+                    return false;
+                }
+                out.index = static_cast<int>(number);
+                break;
+            case Field::Timestamp: if (!in.integer(out.timestamp)) return false; break;
+            case Field::Rand:      if (!in.integer(out.rand)) return false; break;
+            case Field::Other:     if (!in.skipScalar()) return false; break;
+            }
+        } while (in.eat(','));
+
+        if (!in.eat('}')) return false;
+    }
+    return in.atEnd();
+}
+
+void BlockFromView(const RequestView& view, CandidateBlock& out) {
+    out.id.assign(view.id);
+    out.parentId.assign(view.parentId);
+    out.index     = view.index;
+    out.timestamp = view.timestamp;
+    out.nonce     = static_cast<std::uint32_t>(view.rand);
+    out.name.assign(view.name);
+    out.filePath = view.ele;
+    out.cls = NodeClassFromString(view.cls);
+
+    // A malformed hash stays all-zero and fails mining (same as the Poco path)
+    out.hash = Hash256{};
+    HashFromHex(view.hash, out.hash);
+}
+
+// ---------------- General Path (Poco DOM) ----------------
+
+CandidateBlock BlockFromJson(const Poco::JSON::Object::Ptr& obj) {
+    CandidateBlock b;
+
+    // id: Globally unique identifier, e.g., "001-01-02"
+    b.id       = obj->optValue<std::string>("id", "");
+    b.parentId = obj->optValue<std::string>("parent_id", "root");
+
+    b.index     = obj->optValue<int>("index", 0);
+
+    long long ts   = obj->optValue<long long>("timestamp", 0);
+    long long rand = obj->optValue<long long>("rand", 0);
+
+    b.timestamp = static_cast<std::int64_t>(ts);
+    b.nonce     = static_cast<std::uint32_t>(rand);
+
+    b.name      = obj->optValue<std::string>("name", "");
+    std::string elePath = obj->optValue<std::string>("ele", "");
+    b.filePath  = std::filesystem::path(elePath);
+
+    std::string clazz = obj->optValue<std::string>("class", "big");
+    b.cls = NodeClassFromString(clazz);
+
+    // hash: 64 hex chars (SHA-256); a malformed value stays all-zero and fails mining
+    HashFromHex(obj->optValue<std::string>("hash", ""), b.hash);
+
+    return b;
+}
+
+Poco::JSON::Object::Ptr BlockToJson(const CandidateBlock& block) {
+    Poco::JSON::Object::Ptr obj = new Poco::JSON::Object();
+    obj->set("id", block.id);
+    obj->set("parent_id", block.parentId);
+    obj->set("index", block.index);
+    obj->set("timestamp", static_cast<std::int64_t>(block.timestamp));
+    obj->set("rand", static_cast<std::int64_t>(block.nonce));
+    obj->set("name", block.name);
+    obj->set("ele", block.filePath.string());
+    obj->set("class", NodeClassToString(block.cls));
+    obj->set("hash", HashToHex(block.hash));
+    return obj;
+}
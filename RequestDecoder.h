@@ -0,0 +1,40 @@
+// RequestDecoder.h
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include <Poco/JSON/Object.h>
+
+#include "BlockTree.h"
+
+// Fields of a flat request line, as views into the line itself (valid while it lives).
+// Missing fields keep the same defaults the Poco path uses.
+struct RequestView {
+    std::string_view mode = "add";
+    std::string_view id;
+    std::string_view parentId = "root";
+    int index = 0;
+    std::int64_t timestamp = 0;
+    std::int64_t rand = 0;
+    std::string_view name;
+    std::string_view ele;
+    std::string_view cls = "big";
+    std::string_view hash;
+};
+
+// Decode one request line in a single pass, without building a JSON DOM.
+// Handles the flat object used by add / check / view_node; returns false for
+// anything else (nested values, escaped strings, non-integer numbers, a known
+// field with an unexpected type, malformed JSON) so the caller can fall back to
+// Poco, which then decides exactly as before. Unknown scalar fields are skipped.
+bool DecodeRequest(std::string_view line, RequestView& out);
+
+// Request fields -> CandidateBlock (reuses `out`'s string buffers)
+void BlockFromView(const RequestView& view, CandidateBlock& out);
+
+// Parsed JSON object -> CandidateBlock (the general path)
+CandidateBlock BlockFromJson(const Poco::JSON::Object::Ptr& obj);
+
+// CandidateBlock -> JSON object with the same field names (no "mode")
+Poco::JSON::Object::Ptr BlockToJson(const CandidateBlock& block);
@@ -0,0 +1,666 @@
+// RequestHandlers.cpp
+#include "RequestHandlers.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <chrono>
+#include <shared_mutex>
+
+// Use Poco JSON as the JSON library (your original pseudocode closely resembles Poco's style)
+#include <Poco/JSON/Object.h>
+#include <Poco/JSON/Array.h>
+#include <Poco/Dynamic/Var.h>
+
+#include "Metrics.h"
+#include "RequestDecoder.h"
+#include "TreeSync.h"
+
+namespace JSON   = Poco::JSON;
+
+namespace {
+
+// ---------------- JSON → CandidateBlock Parsing ----------------
+
+// "blocks": [ {...}, {...} ] → CandidateBlocks (non-object entries are rejected)
+bool batchFromJson(const JSON::Object::Ptr& obj, std::vector<CandidateBlock>& blocks) {
+    JSON::Array::Ptr arr = obj->getArray("blocks");
+    if (!arr) return false;
+
+    blocks.clear();
+    blocks.reserve(arr->size());
+    for (unsigned i = 0; i < arr->size(); ++i) {
+        JSON::Object::Ptr item = arr->getObject(i);
+        if (!item) return false;
+        blocks.push_back(BlockFromJson(item));
+    }
+    return true;
+}
+
+// ---------------- Local Mining (BlockTree-only) ----------------
+
+bool localMiner(const CandidateBlock& block, BlockTree& tree) {
+    return tree.miner(block);
+}
+
+bool localMinerBatch(const JSON::Object::Ptr& obj, BlockTree& tree) {
+    std::vector<CandidateBlock> blocks;
+    if (!batchFromJson(obj, blocks)) return false;
+    return tree.sortBatch(blocks) && tree.minerBatch(blocks);
+}
+
+// ---------------- Consensus Interaction with Other Nodes ----------------
+
+// Assume requester.send_check(...) accepts a JSON and returns a JSON
+bool checkWithOthers(const JSON::Object::Ptr& obj) {
+    JSON::Object::Ptr resp = requester.send_check(obj);
+    if (!resp) return false;
+
+    return resp->optValue<bool>("answer", false);
+}
+
+// "check" request asking peers to verify one block
+JSON::Object::Ptr checkRequest(const CandidateBlock& block) {
+    JSON::Object::Ptr req = BlockToJson(block);
+    req->set("mode", "check");
+    return req;
+}
+
+// ---------------- Stats ----------------
+
+// Counts at the previous "stats" request, for rates over the last interval
+struct StatsInterval {
+    std::mutex mutex;
+    MetricsSnapshot previous;
+};
+
+double Micros(std::uint64_t ns) {
+    return double(ns) / 1000.0;
+}
+
+double Rate(std::uint64_t now, std::uint64_t before, double seconds) {
+    return seconds > 0 && now >= before ? double(now - before) / seconds : 0.0;
+}
+
+JSON::Object::Ptr statsResponse(NodeState& node) {
+    static StatsInterval interval;
+    const MetricsSnapshot snap = Metrics::snapshot();
+
+    MetricsSnapshot previous;
+    {
+        std::lock_guard<std::mutex> lock(interval.mutex);
+        previous = interval.previous;
+        interval.previous = snap;
+    }
+    const double window = snap.uptimeSeconds - previous.uptimeSeconds;
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("uptime_s", snap.uptimeSeconds);
+    body->set("interval_s", window);
+
+    // Latencies in microseconds; "rate" is per second since start, "recent_rate"
+    // per second since the previous stats request
+    JSON::Object::Ptr latency = new JSON::Object();
+    for (std::size_t m = 0; m < std::size_t(Metric::Count); ++m) {
+        const HistogramSnapshot& h = snap.metrics[m];
+        JSON::Object::Ptr entry = new JSON::Object();
+        entry->set("count", h.count);
+        entry->set("errors", h.errors);
+        entry->set("p50_us", Micros(h.percentile(0.50)));
+        entry->set("p99_us", Micros(h.percentile(0.99)));
+        entry->set("p999_us", Micros(h.percentile(0.999)));
+        entry->set("max_us", Micros(h.maxNs));
+        entry->set("mean_us", h.meanNs() / 1000.0);
+        entry->set("rate", Rate(h.count, 0, snap.uptimeSeconds));
+        entry->set("recent_rate", Rate(h.count, previous.metrics[m].count, window));
+        latency->set(MetricName(Metric(m)), entry);
+    }
+    body->set("latency", latency);
+
+    JSON::Object::Ptr counters = new JSON::Object();
+    for (std::size_t c = 0; c < std::size_t(Counter::Count); ++c) {
+        counters->set(CounterName(Counter(c)), snap.counters[c]);
+    }
+    counters->set("request_rate", Rate(snap[Counter::Requests], 0, snap.uptimeSeconds));
+    counters->set("recent_request_rate",
+                  Rate(snap[Counter::Requests], previous[Counter::Requests], window));
+    body->set("counters", counters);
+
+    const ResourceStats rs = node.resMgr.stats();
+    JSON::Object::Ptr resources = new JSON::Object();
+    resources->set("loads", rs.loads);
+    resources->set("load_failures", rs.loadFailures);
+    resources->set("loaded_bytes", rs.loadedBytes);
+    resources->set("cancelled", rs.cancelled);
+    resources->set("pack_loads", rs.packLoads);
+    resources->set("packs", static_cast<std::uint64_t>(node.resMgr.packCount()));
+    resources->set("hits", rs.hits);
+    resources->set("misses", rs.misses);
+    resources->set("evictions", rs.evictions);
+    resources->set("resident_bytes", static_cast<std::uint64_t>(rs.residentBytes));
+    resources->set("stall_rate", rs.stallRate());
+    resources->set("prefetch_hit_rate", rs.prefetchHitRate());
+    resources->set("preload_total", static_cast<std::uint64_t>(rs.preloadTotal));
+    resources->set("preload_pending", static_cast<std::uint64_t>(rs.preloadPending));
+    resources->set("preload_first_frame", static_cast<std::uint64_t>(rs.preloadFirstFrame));
+    resources->set("time_to_first_ready_ms", rs.timeToFirstReadyMs);
+    resources->set("time_to_all_ready_ms", rs.timeToAllReadyMs);
+
+    const ManifestStats ms = node.resMgr.manifestStats();
+    JSON::Object::Ptr manifest = new JSON::Object();
+    manifest->set("files", static_cast<std::uint64_t>(ms.files));
+    manifest->set("dirs", static_cast<std::uint64_t>(ms.dirs));
+    manifest->set("scan_ms", ms.scanMs);
+    manifest->set("watching", ms.watching);
+    manifest->set("events", ms.events);
+    manifest->set("rescans", ms.rescans);
+    manifest->set("hits", ms.hits);
+    manifest->set("misses", ms.misses);
+    resources->set("manifest", manifest);
+    body->set("resources", resources);
+
+    JSON::Object::Ptr tree = new JSON::Object();
+    {
+        std::shared_lock<TreeLock> read(node.treeLock);
+        const auto counts = node.tree.classCounts();
+        tree->set("nodes", static_cast<std::uint64_t>(node.tree.size()));
+        for (NodeClass cls : {NodeClass::Root, NodeClass::Big, NodeClass::Child, NodeClass::Tiny}) {
+            tree->set(NodeClassToString(cls),
+                      static_cast<std::uint64_t>(counts[static_cast<std::size_t>(cls)]));
+        }
+    }
+    body->set("tree", tree);
+
+    const MinerCacheStats cs = node.tree.minerCacheStats();
+    JSON::Object::Ptr checkCache = new JSON::Object();
+    checkCache->set("hits", cs.hits);
+    checkCache->set("misses", cs.misses);
+    checkCache->set("hit_rate", cs.hitRate());
+    checkCache->set("evictions", cs.evictions);
+    checkCache->set("entries", static_cast<std::uint64_t>(cs.entries));
+    checkCache->set("capacity", static_cast<std::uint64_t>(cs.capacity));
+    body->set("check_cache", checkCache);
+
+    JSON::Array::Ptr levels = new JSON::Array();
+    for (const DifficultyStats& ds : NonceSearch::stats()) {
+        JSON::Object::Ptr level = new JSON::Object();
+        level->set("difficulty", ds.difficulty);
+        level->set("searches", ds.searches);
+        level->set("solved", ds.solved);
+        level->set("hashes", ds.hashes);
+        level->set("seconds", ds.seconds);
+        level->set("hash_rate", ds.hashRate());
+        levels->add(level);
+    }
+    JSON::Object::Ptr pow = new JSON::Object();
+    pow->set("difficulty", node.tree.difficulty());
+    pow->set("levels", levels);
+    body->set("pow", pow);
+
+    JSON::Array::Ptr peers = new JSON::Array();
+    for (const PeerQuorum::PeerInfo& info : requester.peers().peers()) {
+        JSON::Object::Ptr peer = new JSON::Object();
+        peer->set("address", info.address);
+        peer->set("connected", info.connected);
+        peer->set("ewma_ms", info.ewmaMs);
+        peer->set("answers", info.answers);
+        peer->set("timeouts", info.timeouts);
+        peer->set("errors", info.errors);
+        peers->add(peer);
+    }
+    body->set("peers", peers);
+    return body;
+}
+
+// ---------------- Inclusion Proofs ----------------
+
+// Proof that a node belongs to the tree under the current aggregate root.
+// A light client recomputes "root" from the levels (see BlockTree::verifyProof).
+JSON::Object::Ptr proofResponse(const InclusionProof& proof) {
+    JSON::Array::Ptr levels = new JSON::Array();
+    for (const InclusionProof::Level& level : proof.levels) {
+        JSON::Object::Ptr entry = new JSON::Object();
+        entry->set("id", level.id);
+        entry->set("hash", HashToHex(level.hash));
+        entry->set("child_count", level.childCount);
+        JSON::Array::Ptr siblings = new JSON::Array();
+        for (const MerkleStep& step : level.siblings) {
+            JSON::Object::Ptr sibling = new JSON::Object();
+            sibling->set(step.left ? "left" : "right", HashToHex(step.hash));
+            siblings->add(sibling);
+        }
+        entry->set("siblings", siblings);
+        levels->add(entry);
+    }
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("id", proof.levels.front().id);
+    body->set("child_root", HashToHex(proof.childRoot));
+    body->set("levels", levels);
+    body->set("root", HashToHex(proof.root));
+    return body;
+}
+
+// ---------------- Queries ----------------
+
+// {"mode":"query", "class":"tiny", "name_prefix":"Bamboo", "under":"003",
+//  "since":ms, "until":ms, "limit":100, "cursor":"..."}; every filter is optional
+NodeQuery queryFromJson(const JSON::Object::Ptr& request) {
+    NodeQuery q;
+    if (request->has("class")) {
+        q.hasClass = true;
+        q.cls = NodeClassFromString(request->getValue<std::string>("class"));
+    }
+    q.namePrefix = request->optValue<std::string>("name_prefix", "");
+    q.under = request->optValue<std::string>("under", "");
+    if (request->has("since")) {
+        q.hasSince = true;
+        q.since = request->getValue<long long>("since");
+    }
+    if (request->has("until")) {
+        q.hasUntil = true;
+        q.until = request->getValue<long long>("until");
+    }
+    q.limit = static_cast<std::size_t>(std::clamp(request->optValue<int>("limit", 100), 1, 1000));
+    q.cursor = request->optValue<std::string>("cursor", "");
+    return q;
+}
+
+// One page of results; built under the read lock (the NodeRefs read the tree)
+JSON::Object::Ptr queryResponse(const QueryPage& page) {
+    JSON::Array::Ptr results = new JSON::Array();
+    for (NodeRef n : page.nodes) {
+        JSON::Object::Ptr entry = new JSON::Object();
+        entry->set("id", std::string(n.id()));
+        entry->set("parent_id", n.parent() ? std::string(n.parent().id()) : std::string());
+        entry->set("name", std::string(n.name()));
+        entry->set("class", NodeClassToString(n.cls()));
+        entry->set("timestamp", static_cast<std::int64_t>(n.timestamp()));
+        entry->set("ele", std::string(n.filePath()));
+        results->add(entry);
+    }
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("results", results);
+    body->set("by", page.by);
+    body->set("scanned", static_cast<std::uint64_t>(page.scanned));
+    if (!page.next.empty()) body->set("next", page.next);
+    return body;
+}
+
+// ---------------- Region Views ----------------
+
+// {"mode":"view_batch", "ids":[...]} or {"mode":"view_batch", "id":..., "radius":2,
+//  "max_nodes":64, "max_bytes":...}
+ViewRegion regionFromJson(const JSON::Object::Ptr& request) {
+    ViewRegion region;
+    if (JSON::Array::Ptr ids = request->getArray("ids")) {
+        for (std::size_t i = 0; i < ids->size(); ++i) {
+            region.ids.push_back(ids->getElement<std::string>(static_cast<unsigned>(i)));
+        }
+    } else {
+        region.center = request->optValue<std::string>("id", "");
+        region.radius = static_cast<std::size_t>(
+            std::clamp(request->optValue<int>("radius", 1), 0, 16));
+    }
+    region.maxNodes = static_cast<std::size_t>(
+        std::max(request->optValue<int>("max_nodes", 256), 0));
+    region.maxBytes = static_cast<std::size_t>(
+        std::max(request->optValue<long long>("max_bytes", 0), 0LL));
+    return region;
+}
+
+// Built under the read lock (the NodeRefs read the tree)
+JSON::Object::Ptr viewBatchResponse(const ViewBatchResult& result) {
+    JSON::Array::Ptr nodes = new JSON::Array();
+    std::size_t ready = 0;
+    for (const ViewBatchResult::Entry& entry : result.nodes) {
+        JSON::Object::Ptr n = new JSON::Object();
+        n->set("id", std::string(entry.node.id()));
+        n->set("state", entry.hasResource ? LoadStateToString(entry.state) : "none");
+        n->set("ready", !entry.hasResource || entry.state == LoadState::Loaded);
+        ready += !entry.hasResource || entry.state == LoadState::Loaded;
+        nodes->add(n);
+    }
+    JSON::Array::Ptr missing = new JSON::Array();
+    for (const std::string& id : result.missing) missing->add(id);
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("nodes", nodes);
+    body->set("ready", static_cast<std::uint64_t>(ready));
+    body->set("ancestors", static_cast<std::uint64_t>(result.ancestors));
+    body->set("shared_ancestors", static_cast<std::uint64_t>(result.sharedAncestors));
+    body->set("estimated_bytes", static_cast<std::uint64_t>(result.estimatedBytes));
+    body->set("truncated", result.truncated);
+    body->set("missing", missing);
+    return body;
+}
+
+// ---------------- Nonce Search ----------------
+
+// "mine" deadline: default and upper bound of the request's "timeout_ms"
+constexpr int kMineTimeoutMs = 2000;
+constexpr int kMineTimeoutMaxMs = 10000;
+
+// The mined fields, in the shape an "add" request takes them back
+JSON::Object::Ptr mineResponse(const CandidateBlock& block, const NonceSearchResult& result) {
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("id", block.id);
+    body->set("found", result.found);
+    body->set("timed_out", result.timedOut);
+    if (result.found) {
+        body->set("rand", static_cast<std::uint64_t>(block.nonce));
+        body->set("timestamp", static_cast<std::int64_t>(block.timestamp));
+        body->set("hash", HashToHex(block.hash));
+    }
+    body->set("difficulty", result.difficulty);
+    body->set("hashes", result.hashes);
+    body->set("seconds", result.seconds);
+    body->set("hash_rate", result.hashRate());
+    body->set("threads", result.threads);
+    return body;
+}
+
+} // namespace
+
+bool isFlatMode(std::string_view mode) {
+    return mode == "add" || mode == "check" || mode == "view_node" || mode == "prove";
+}
+
+bool isWriteMode(const std::string& mode) {
+    return mode == "add" || mode == "add_batch" || mode == "sync";
+}
+
+// ---------------- Complete Process for Adding a New Block ----------------
+
+// Runs on the writer thread. Only this thread changes the tree, so it reads without
+// the lock; readers are shut out just for the commit itself.
+bool handleAdd(const CandidateBlock& block,
+               BlockTree& tree,
+               BlockStore& store,
+               ResourceManager& resMgr,
+               TreeLock& treeLock) {
+    // 1. Local mining verification
+    Metrics::Timer mine(Metric::AddMine);
+    if (!mine.done(tree.miner(block))) {
+        std::cerr << "[handleAdd] local miner failed, reject block id="
+                  << block.id << '\n';
+        return false;
+    }
+
+    // 2. Consortium chain / other nodes consensus
+    Metrics::Timer remote(Metric::AddRemote);
+    if (!remote.done(checkWithOthers(checkRequest(block)))) {
+        std::cerr << "[handleAdd] remote check failed, reject block id="
+                  << block.id << '\n';
+        return false;
+    }
+
+    // 3. Write to tree-structured blockchain and register the resource
+    //    (hand over to ResourceManager for game integration) in one step for readers
+    Metrics::Timer commitTimer(Metric::AddCommit);
+    if (!store.writable()) {
+        std::cerr << "[handleAdd] block log is failing, reject block id=" << block.id << '\n';
+        return false;
+    }
+    NodeRef node;
+    {
+        std::unique_lock<TreeLock> commit(treeLock);
+        try {
+            node = tree.addNode(block);
+        } catch (const std::exception& e) {
+            std::cerr << "[handleAdd] " << e.what() << ", reject block id=" << block.id << '\n';
+            return false;
+        }
+        resMgr.registerNode(node);
+    }
+
+    // 4. Durable log, on disk before the add is acknowledged (like commitBatch). Adds
+    //    run one at a time on this thread, so there is no group to wait for.
+    store.append(tree, node);
+    if (!commitTimer.done(store.sync())) {
+        std::cerr << "[handleAdd] block log write failed, not acknowledging block id="
+                  << node.id() << '\n';
+        return false;
+    }
+
+    std::cout << "[handleAdd] block accepted, id=" << node.id()
+              << ", hash=" << HashToHex(node.hash()) << '\n';
+    return true;
+}
+
+// ---------------- Adding a Whole Batch (one consensus round-trip) ----------------
+
+// Runs on the writer thread, like handleAdd
+bool handleAddBatch(const JSON::Object::Ptr& obj,
+                    BlockTree& tree,
+                    BlockStore& store,
+                    ResourceManager& resMgr,
+                    TreeLock& treeLock) {
+    std::vector<CandidateBlock> blocks;
+    if (!batchFromJson(obj, blocks) || blocks.empty()) {
+        std::cerr << "[handleAddBatch] missing or malformed \"blocks\" array\n";
+        return false;
+    }
+
+    // 1. Parents before children (parents may be in the same batch)
+    std::string error;
+    if (!tree.sortBatch(blocks, &error)) {
+        std::cerr << "[handleAddBatch] reject batch: " << error << '\n';
+        return false;
+    }
+
+    // 2. Local mining verification of every block
+    std::string failedId;
+    if (!tree.minerBatch(blocks, &failedId)) {
+        std::cerr << "[handleAddBatch] local miner failed, reject batch at block id="
+                  << failedId << '\n';
+        return false;
+    }
+
+    // 3. One aggregated consensus request for the whole batch
+    JSON::Object::Ptr checkReq = new JSON::Object();
+    checkReq->set("mode", "check_batch");
+    checkReq->set("blocks", obj->getArray("blocks"));
+    if (!checkWithOthers(checkReq)) {
+        std::cerr << "[handleAddBatch] remote check failed, reject batch of "
+                  << blocks.size() << " blocks\n";
+        return false;
+    }
+
+    // 4. Commit all blocks and register their resources
+    if (!commitBatch(blocks, tree, store, resMgr, treeLock)) {
+        std::cerr << "[handleAddBatch] block log write failed, not acknowledging batch of "
+                  << blocks.size() << " blocks\n";
+        return false;
+    }
+
+    std::cout << "[handleAddBatch] batch accepted, " << blocks.size() << " blocks\n";
+    return true;
+}
+
+bool commitBatch(const std::vector<CandidateBlock>& blocks,
+                 BlockTree& tree,
+                 BlockStore& store,
+                 ResourceManager& resMgr,
+                 TreeLock& treeLock) {
+    if (!store.writable()) return false;
+
+    std::vector<NodeRef> nodes;
+    {
+        std::unique_lock<TreeLock> commit(treeLock);
+        nodes = tree.addBatch(blocks);
+        for (NodeRef node : nodes) {
+            resMgr.registerNode(node);
+        }
+    }
+    for (NodeRef node : nodes) {
+        store.append(tree, node);
+    }
+    return store.sync();
+}
+
+// ---------------- Dispatch ----------------
+
+bool handleRequest(const std::string& mode,
+                   const CandidateBlock& block,
+                   const JSON::Object::Ptr& request,
+                   NodeState& node,
+                   JSON::Object::Ptr* body) {
+    if (mode == "add") {
+        // Frontend / other node request: Add a new block
+        Metrics::Timer timer(Metric::Add);
+        return timer.done(handleAdd(block, node.tree, node.store, node.resMgr, node.treeLock));
+
+    } else if (mode == "add_batch") {
+        // Curator upload: many blocks, accepted or rejected as a whole
+        Metrics::Timer timer(Metric::AddBatch);
+        return timer.done(handleAddBatch(request, node.tree, node.store, node.resMgr, node.treeLock));
+
+    } else if (mode == "check") {
+        // Other node query: Help verify if this block is valid
+        Metrics::Timer timer(Metric::Check);
+        std::shared_lock<TreeLock> read(node.treeLock);
+        return timer.done(localMiner(block, node.tree));
+
+    } else if (mode == "check_batch") {
+        // Other node query: Verify a whole batch, one answer for all of it
+        Metrics::Timer timer(Metric::CheckBatch);
+        std::shared_lock<TreeLock> read(node.treeLock);
+        return timer.done(localMinerBatch(request, node.tree));
+
+    } else if (mode == "view_node") {
+        // Client only wants to view resources corresponding to a building / room / tiny object
+        Metrics::Timer timer(Metric::ViewNode);
+        const std::string& id = block.id;
+        if (id.empty()) return timer.done(false);
+
+        std::shared_lock<TreeLock> read(node.treeLock);
+        // Only queues the loads; the worker moves on while they run.
+        // To report "resource ready" later, keep the future returned here
+        node.resMgr.ensureLoadedForView(id, node.tree);
+        return timer.done(static_cast<bool>(node.tree.findNode(id)));
+
+    } else if (mode == "view_batch") {
+        // Client focusing a region: several nodes, one traversal, ancestors queued once
+        Metrics::Timer timer(Metric::ViewBatch);
+        const ViewRegion region = regionFromJson(request);
+        std::shared_lock<TreeLock> read(node.treeLock);
+        const ViewBatchResult result = node.resMgr.ensureLoadedForRegion(region, node.tree);
+        if (body) *body = viewBatchResponse(result);
+        return timer.done(!result.nodes.empty());
+
+    } else if (mode == "prove") {
+        // Light client / game frontend: inclusion proof of one node against the root
+        Metrics::Timer timer(Metric::Prove);
+        InclusionProof proof;
+        {
+            std::shared_lock<TreeLock> read(node.treeLock);
+            if (!node.tree.prove(block.id, proof)) return timer.done(false);
+        }
+        if (body) *body = proofResponse(proof);
+        return timer.done(true);
+
+    } else if (mode == "mine") {
+        // Client about to add a block: find a nonce that meets the difficulty (nothing is committed)
+        Metrics::Timer timer(Metric::Mine);
+        CandidateBlock mined = BlockFromJson(request);
+        const auto timeout = std::chrono::milliseconds(
+            std::clamp(request->optValue<int>("timeout_ms", kMineTimeoutMs), 1, kMineTimeoutMaxMs));
+        Hash256 parentHash;
+        {
+            std::shared_lock<TreeLock> read(node.treeLock);
+            NodeRef parent = node.tree.findNode(mined.parentId);
+            if (!parent) return timer.done(false);
+            parentHash = parent.hash();
+        }
+        // Searched without the tree lock, so commits go on meanwhile. Each search already
+        // uses every core, so a second one is turned away rather than parking a reader
+        // thread behind the first; the deadline bounds how long this reader is taken.
+        static std::mutex searching;
+        std::unique_lock<std::mutex> one(searching, std::try_to_lock);
+        if (!one.owns_lock()) {
+            if (body) {
+                *body = new JSON::Object();
+                (*body)->set("busy", true);
+            }
+            return timer.done(false);
+        }
+        const NonceSearchResult result =
+            node.tree.mine(mined, parentHash, 0, NonceSearch::Clock::now() + timeout);
+        one.unlock();
+        if (body) *body = mineResponse(mined, result);
+        return timer.done(result.found);
+
+    } else if (mode == "sync") {
+        // Operator: pull missing blocks from another replica (runs on the writer)
+        Metrics::Timer timer(Metric::Sync);
+        const TreeSync::Stats stats =
+            TreeSync::pull(request->optValue<std::string>("peer", ""), node);
+        if (body) {
+            JSON::Object::Ptr result = new JSON::Object();
+            result->set("rounds", stats.rounds);
+            result->set("compared", stats.compared);
+            result->set("missing", stats.missing);
+            result->set("blocks", stats.blocks);
+            result->set("conflicts", stats.conflicts);
+            result->set("bytes_sent", stats.bytesSent);
+            result->set("bytes_received", stats.bytesReceived);
+            result->set("ms", stats.ms);
+            *body = result;
+        }
+        return timer.done(stats.ok);
+
+    } else if (mode == "sync_digest") {
+        // Replica pulling from us: children digests of the nodes it found different
+        std::shared_lock<TreeLock> read(node.treeLock);
+        JSON::Object::Ptr result = TreeSync::digestResponse(node.tree, request->getArray("ids"));
+        if (body) *body = result;
+        return true;
+
+    } else if (mode == "sync_blocks") {
+        // Replica pulling from us: one batch of its missing subtrees
+        const int max = std::clamp(request->optValue<int>("max", 512), 1, 4096);
+        std::shared_lock<TreeLock> read(node.treeLock);
+        JSON::Object::Ptr result =
+            TreeSync::blocksResponse(node.tree, request->getArray("ids"), static_cast<std::size_t>(max));
+        if (body) *body = result;
+        return true;
+
+    } else if (mode == "query") {
+        // Curation dashboard: nodes by class / name prefix / subtree / time range, paged
+        Metrics::Timer timer(Metric::Query);
+        const NodeQuery q = queryFromJson(request);
+        QueryPage page;
+        std::shared_lock<TreeLock> read(node.treeLock);
+        if (!node.tree.query(q, page)) return timer.done(false);
+        if (body) *body = queryResponse(page);
+        return timer.done(true);
+
+    } else if (mode == "stats") {
+        // Operator query: latency percentiles, rates, loader and tree counters
+        if (body) *body = statsResponse(node);
+        return true;
+    }
+
+    std::cerr << "[main] unknown mode: " << mode << '\n';
+    return false;
+}
+
+void respond(const Requester::Ticket& ticket, const std::string& mode, bool ok,
+             const JSON::Object::Ptr& body) {
+    if (mode == "check" || mode == "check_batch") {
+        requester.send_checkans(ticket, ok);
+        return;
+    }
+    JSON::Object::Ptr resp = body ? body : new JSON::Object();
+    resp->set("mode", mode);
+    resp->set("ok", ok);
+    requester.send_response(ticket, resp);
+}
+
+void registerTree(const BlockTree& tree, ResourceManager& resMgr) {
+    for (NodeIndex slot = 0; slot < tree.size(); ++slot) {
+        resMgr.registerNode(tree.node(slot));
+    }
+}
@@ -0,0 +1,71 @@
+// RequestHandlers.h
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Poco/JSON/Object.h>
+
+#include "BlockStore.h"
+#include "BlockTree.h"
+#include "ResourceManager.h"
+#include "TreeLock.h"
+#include "requester.h"
+
+// Handlers behind the node's request modes. main.cpp decides which thread runs them:
+// adds on the single writer, everything else on the reader pool.
+
+// Everything a request handler may touch
+struct NodeState {
+    BlockTree& tree;
+    BlockStore& store;
+    ResourceManager& resMgr;
+    TreeLock& treeLock;
+};
+
+// Modes whose request is one flat block object (RequestDecoder's fast path)
+bool isFlatMode(std::string_view mode);
+
+// Modes that change the tree (they must all run on one writer thread)
+bool isWriteMode(const std::string& mode);
+
+// Complete process for adding a new block: local mining, peer consensus, commit
+bool handleAdd(const CandidateBlock& block,
+               BlockTree& tree,
+               BlockStore& store,
+               ResourceManager& resMgr,
+               TreeLock& treeLock);
+
+// Adding a whole batch (one consensus round-trip, all-or-nothing)
+bool handleAddBatch(const Poco::JSON::Object::Ptr& obj,
+                    BlockTree& tree,
+                    BlockStore& store,
+                    ResourceManager& resMgr,
+                    TreeLock& treeLock);
+
+// Commit a sorted, verified batch: tree and resources in one step for readers, then the
+// block log (synced). Used by add_batch after consensus and by TreeSync for pulled blocks.
+// False if the block log is failing (nothing is committed) or could not be synced.
+bool commitBatch(const std::vector<CandidateBlock>& blocks,
+                 BlockTree& tree,
+                 BlockStore& store,
+                 ResourceManager& resMgr,
+                 TreeLock& treeLock);
+
+// Handle one decoded request; `block` is set for flat modes, `request` for the others.
+// Modes that answer with more than "ok" (stats, prove, sync*) put their fields in `*body` if given.
+bool handleRequest(const std::string& mode,
+                   const CandidateBlock& block,
+                   const Poco::JSON::Object::Ptr& request,
+                   NodeState& node,
+                   Poco::JSON::Object::Ptr* body = nullptr);
+
+// One-line result for the client that sent the request
+// ({"answer": ...} to peers asking for a check, {"mode": ..., "ok": ...} otherwise,
+// added to `body` when the handler filled one)
+void respond(const Requester::Ticket& ticket, const std::string& mode, bool ok,
+             const Poco::JSON::Object::Ptr& body = nullptr);
+
+// Register resources for every node restored from disk (arena order: parents before children)
+void registerTree(const BlockTree& tree, ResourceManager& resMgr);
@@ -1,85 +1,700 @@
 // ResourceManager.cpp
 #include "ResourceManager.h"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <unordered_set>
 
-ResourceManager::ResourceManager(const std::filesystem::path& baseDir)
-    : baseDir_(baseDir) {}
+#include "Metrics.h"
 
-void ResourceManager::registerNode(const std::shared_ptr<Node>& node) {
-    if (!node) return;
+namespace {
+
+std::shared_future<LoadState> ReadyFuture(LoadState state) {
+    std::promise<LoadState> promise;
+    promise.set_value(state);
+    return promise.get_future().share();
+}
+
+} // anonymous namespace
+
+std::string LoadStateToString(LoadState state) {
+    switch (state) {
+        case LoadState::Unloaded:  return "unloaded";
+        case LoadState::Queued:    return "queued";
+        case LoadState::Loading:   return "loading";
+        case LoadState::Loaded:    return "loaded";
+        case LoadState::Failed:    return "failed";
+        case LoadState::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+ResourceManager::ResourceManager(const std::filesystem::path& baseDir, unsigned loaderThreads,
+                                 unsigned ioThreads)
+    : baseDir_(baseDir),
+      manifest_(baseDir),
+      ioPool_(ioThreads),
+      pool_(loaderThreads) {}
+
+bool ResourceManager::buildManifest(unsigned threads, bool watch) {
+    return manifest_.build(threads, watch);
+}
+
+std::size_t ResourceManager::mountPacks(const std::filesystem::path& dir) {
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().extension() == ".hpak") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());      // Deterministic precedence for duplicate keys
+
+    std::size_t mounted = 0;
+    for (const auto& file : files) {
+        auto pack = AssetPack::open(file);
+        if (!pack) continue;
+        std::cout << "[ResourceManager] mounted " << file << " (" << pack->assetCount()
+                  << " assets, " << pack->mappedBytes() << " bytes)\n";
+        std::unique_lock<std::shared_mutex> lock(packsMutex_);
+        packs_.push_back(std::move(pack));
+        ++mounted;
+    }
+    return mounted;
+}
+
+std::size_t ResourceManager::packCount() const {
+    std::shared_lock<std::shared_mutex> lock(packsMutex_);
+    return packs_.size();
+}
+
+void ResourceManager::registerNode(NodeRef node) {
+    if (!node || node.filePath().empty()) return;
 
     GameResource res;
-    res.id  = node->id;
-    res.cls = node->cls;
+    res.id  = std::string(node.id());
+    res.cls = node.cls();
 
-    if (node->filePath.is_absolute()) {
-        res.path = node->filePath;
-    } else {
-        res.path = baseDir_ / node->filePath;
+    // Relative paths are kept as manifest keys; baseDir_ is only prepended when a load
+    // has to touch the file system
+    res.path = std::filesystem::path(node.filePath());
+    if (!res.path.is_absolute()) {
+        res.manifestKey = AssetManifest::keyOf(res.path);
     }
 
-    res.loaded = false;
+    res.state = LoadState::Unloaded;
+    res.registered = true;
+    for (NodeRef p = node.parent(); p; p = p.parent()) ++res.depth;
 
-    resources_[res.id] = std::move(res);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (node.slot() >= resources_.size()) {
+        resources_.resize(node.slot() + 1);
+    }
+    if (!resources_[node.slot()].registered) {
+        byClass_[static_cast<std::size_t>(res.cls)].push_back(node.slot());
+    }
+    resources_[node.slot()] = std::move(res);
 }
 
-void ResourceManager::preloadBigObjects() {
-    for (auto& kv : resources_) {
-        GameResource& res = kv.second;
-        if (res.cls == NodeClass::Big) {
-            loadResource(res);
+GameResource* ResourceManager::resourceFor(NodeIndex slot) {
+    if (slot >= resources_.size()) return nullptr;
+    GameResource& res = resources_[slot];
+    return res.registered ? &res : nullptr;
+}
+
+void ResourceManager::preloadBigObjects(const BlockTree& tree, const std::filesystem::path& mostViewed) {
+    // Rank of each slot in the saved most-viewed list (unlisted slots rank last)
+    std::unordered_map<NodeIndex, std::size_t> rank;
+    if (!mostViewed.empty()) {
+        std::ifstream in(mostViewed);
+        std::string id;
+        while (std::getline(in, id)) {
+            if (const NodeRef node = tree.findNode(id)) rank.emplace(node.slot(), rank.size());
+        }
+    }
+    auto rankOf = [&](NodeIndex slot) {
+        auto it = rank.find(slot);
+        return it == rank.end() ? rank.size() : it->second;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<NodeIndex> order = byClass_[static_cast<std::size_t>(NodeClass::Big)];
+    if (order.empty()) return;
+
+    // First frame: the most viewed shells, topped up with the nearest ones to a fixed size
+    std::sort(order.begin(), order.end(), [&](NodeIndex a, NodeIndex b) {
+        const std::size_t ka = rankOf(a), kb = rankOf(b);
+        if (ka != kb) return ka < kb;
+        const GameResource& ra = resources_[a];
+        const GameResource& rb = resources_[b];
+        return ra.depth != rb.depth ? ra.depth < rb.depth : a < b;
+    });
+    const std::size_t firstTier = std::min(order.size(), kFirstFrameShells);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        GameResource& res = resources_[order[i]];
+        res.resident = true;
+        res.preloadTier = i < firstTier ? 1 : 2;
+    }
+
+    // Load order: the first frame, then the rest; each shallowest level first (parents
+    // before the shells inside them), then by rank and slot
+    std::sort(order.begin(), order.end(), [&](NodeIndex a, NodeIndex b) {
+        const GameResource& ra = resources_[a];
+        const GameResource& rb = resources_[b];
+        if (ra.preloadTier != rb.preloadTier) return ra.preloadTier < rb.preloadTier;
+        if (ra.depth != rb.depth) return ra.depth < rb.depth;
+        const std::size_t ka = rankOf(a), kb = rankOf(b);
+        return ka != kb ? ka < kb : a < b;
+    });
+
+    preloadStart_ = std::chrono::steady_clock::now();
+    stats_.preloadTotal = stats_.preloadPending = order.size();
+    stats_.preloadFirstFrame = firstTierPending_ = firstTier;
+    stats_.timeToFirstReadyMs = stats_.timeToAllReadyMs = 0;
+
+    // The I/O pool runs equal priorities in submission order, so this is the load order
+    for (NodeIndex slot : order) {
+        GameResource& res = resources_[slot];
+        if (res.state == LoadState::Loaded) {
+            preloadDoneLocked(res);
+        } else {
+            requestLocked(slot, LoadPriority::Preload, false);
         }
     }
 }
 
-void ResourceManager::ensureLoadedForView(const std::string& id, const BlockTree& tree) {
+bool ResourceManager::saveMostViewed(const std::filesystem::path& path, std::size_t count) const {
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::pair<std::uint32_t, NodeIndex>> viewed;
+        for (NodeIndex slot = 0; slot < resources_.size(); ++slot) {
+            if (resources_[slot].viewCount > 0) viewed.emplace_back(resources_[slot].viewCount, slot);
+        }
+        count = std::min(count, viewed.size());
+        std::partial_sort(viewed.begin(), viewed.begin() + count, viewed.end(),
+                          [](const auto& a, const auto& b) {
+                              return a.first != b.first ? a.first > b.first : a.second < b.second;
+                          });
+        for (std::size_t i = 0; i < count; ++i) ids.push_back(resources_[viewed[i].second].id);
+    }
+
+    std::ofstream out(path, std::ios::trunc);
+    for (const std::string& id : ids) out << id << '\n';
+    return static_cast<bool>(out.flush());
+}
+
+void ResourceManager::preloadDoneLocked(GameResource& res) {
+    const std::uint8_t tier = res.preloadTier;
+    res.preloadTier = 0;
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - preloadStart_).count();
+
+    if (tier == 1 && --firstTierPending_ == 0) {
+        stats_.timeToFirstReadyMs = ms;
+        std::cout << "[ResourceManager] preload: first frame (" << stats_.preloadFirstFrame
+                  << " big objects) ready in " << ms << " ms\n";
+    }
+    if (--stats_.preloadPending == 0) {
+        stats_.timeToAllReadyMs = ms;
+        std::cout << "[ResourceManager] preload: all " << stats_.preloadTotal
+                  << " big objects ready in " << ms << " ms\n";
+    }
+}
+
+std::shared_future<LoadState> ResourceManager::ensureLoadedForView(const std::string& id,
+                                                                   const BlockTree& tree) {
     auto node = tree.findNode(id);
     if (!node) {
         std::cerr << "[ResourceManager] node not found: " << id << '\n';
-        return;
+        return ReadyFuture(LoadState::Unloaded);
+    }
+
+    std::vector<GameResource> evicted;
+    std::shared_future<LoadState> focus;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // A new focus: queued work from earlier views is cancelled when a loader picks it up
+        ++viewGeneration_;
+
+        auto request = [&](NodeRef n, LoadPriority priority, bool pin) {
+            return viewRequestLocked(n.slot(), priority, pin, n == node);
+        };
+
+        // 1. Current node
+        focus = resourceFor(node.slot())
+            ? request(node, LoadPriority::Focus, true)
+            : ReadyFuture(LoadState::Unloaded);
+
+        // 2. Upward: Ensure all parent nodes are loaded (city block / building shell)
+        auto current = node.parent();
+        while (current) {
+            if (resourceFor(current.slot())) {
+                request(current, LoadPriority::Ancestor, true);
+            }
+            current = current.parent();
+        }
+
+        // 3. Downward: If it's big/child, preload one level of child nodes (room / tiny object)
+        if (node.cls() == NodeClass::Big || node.cls() == NodeClass::Child) {
+            for (NodeRef child : node.children()) {
+                if (resourceFor(child.slot())) {
+                    request(child, LoadPriority::Prefetch, false);
+                }
+            }
+        }
+
+        // 4. Sideways: what the player is likely to look at next
+        prefetcher_.recordView(node);
+        speculateLocked(node, tree);
+
+        // The old focus path is no longer pinned
+        evicted = evictLocked();
+    }
+
+    for (const GameResource& res : evicted) {
+        unloadResource(res.id, res.path);
+    }
+    return focus;
+}
+
+ViewBatchResult ResourceManager::ensureLoadedForRegion(const ViewRegion& region,
+                                                       const BlockTree& tree) {
+    ViewBatchResult result;
+    std::vector<GameResource> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // 1. The region: listed IDs in order, or a breadth-first walk over parent / child
+        //    links from the center (nearest first), cut off by the budget
+        std::vector<NodeRef> nodes;
+        std::unordered_set<NodeIndex> inRegion;
+        std::size_t bytes = 0;
+        auto admit = [&](NodeRef n) {
+            if (inRegion.count(n.slot())) return true;
+            const GameResource* res = resourceFor(n.slot());
+            const std::size_t size = res ? sizeHint(*res) : 0;
+            if ((region.maxNodes && nodes.size() >= region.maxNodes) ||
+                (region.maxBytes && !nodes.empty() && bytes + size > region.maxBytes)) {
+                result.truncated = true;
+                return false;
+            }
+            bytes += size;
+            inRegion.insert(n.slot());
+            nodes.push_back(n);
+            return true;
+        };
+
+        if (!region.center.empty()) {
+            const NodeRef center = tree.findNode(region.center);
+            if (!center) {
+                result.missing.push_back(region.center);
+            } else {
+                admit(center);
+                std::vector<NodeRef> frontier{center};
+                for (std::size_t depth = 0;
+                     depth < region.radius && !frontier.empty() && !result.truncated; ++depth) {
+                    std::vector<NodeRef> next;
+                    for (NodeRef n : frontier) {
+                        auto visit = [&](NodeRef m) {
+                            if (inRegion.count(m.slot()) || !admit(m)) return;
+                            next.push_back(m);
+                        };
+                        if (NodeRef parent = n.parent()) visit(parent);
+                        for (NodeRef child : n.children()) visit(child);
+                        if (result.truncated) break;
+                    }
+                    frontier = std::move(next);
+                }
+            }
+        } else {
+            for (const std::string& id : region.ids) {
+                const NodeRef n = tree.findNode(id);
+                if (!n) {
+                    result.missing.push_back(id);
+                } else if (!admit(n)) {
+                    break;
+                }
+            }
+        }
+        result.estimatedBytes = bytes;
+        if (nodes.empty()) return result;
+
+        // 2. One new focus for the whole region; its nodes load first, in region order
+        ++viewGeneration_;
+        for (NodeRef n : nodes) {
+            if (resourceFor(n.slot())) viewRequestLocked(n.slot(), LoadPriority::Focus, true, true);
+        }
+
+        // 3. Ancestors of the region, each walked once: a climb stops at the first node
+        //    already in the region or reached from another region node
+        std::unordered_set<NodeIndex> climbed;
+        for (NodeRef n : nodes) {
+            for (NodeRef up = n.parent(); up; up = up.parent()) {
+                if (inRegion.count(up.slot()) || !climbed.insert(up.slot()).second) {
+                    ++result.sharedAncestors;
+                    break;
+                }
+                ++result.ancestors;
+                if (resourceFor(up.slot())) viewRequestLocked(up.slot(), LoadPriority::Ancestor, true, false);
+            }
+        }
+
+        // 4. The first node stands for the region in view history / speculation
+        prefetcher_.recordView(nodes.front());
+        speculateLocked(nodes.front(), tree);
+
+        evicted = evictLocked();
+
+        for (NodeRef n : nodes) {
+            const GameResource* res = resourceFor(n.slot());
+            result.nodes.push_back({n, res ? res->state : LoadState::Unloaded, res != nullptr});
+        }
     }
 
-    // 1. Current node
-    auto it = resources_.find(node->id);
-    if (it != resources_.end()) {
-        loadResource(it->second);
+    for (const GameResource& res : evicted) {
+        unloadResource(res.id, res.path);
     }
+    return result;
+}
+
+void ResourceManager::ensureLoadedUnder(const std::string& prefix, const BlockTree& tree) {
+    const std::vector<NodeRef> nodes = tree.findByPrefix(prefix);
 
-    // 2. Upward: Ensure all parent nodes are loaded (city block / building shell)
-    auto current = node->parent.lock();
-    while (current) {
-        auto it2 = resources_.find(current->id);
-        if (it2 != resources_.end()) {
-            loadResource(it2->second);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (NodeRef node : nodes) {
+        if (resourceFor(node.slot())) {
+            requestLocked(node.slot(), LoadPriority::Preload, false);
         }
-        current = current->parent.lock();
     }
+}
 
-    // 3. Downward: If it's big/child, preload one level of child nodes (room / tiny object)
-    if (node->cls == NodeClass::Big || node->cls == NodeClass::Child) {
-        for (auto& child : node->children) {
-            auto it3 = resources_.find(child->id);
-            if (it3 != resources_.end()) {
-                loadResource(it3->second);
+LoadState ResourceManager::state(NodeRef node) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!node || node.slot() >= resources_.size()) return LoadState::Unloaded;
+    return resources_[node.slot()].state;
+}
+
+std::size_t ResourceManager::pendingLoads() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+void ResourceManager::setMemoryBudget(std::size_t bytes) {
+    std::vector<GameResource> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.budgetBytes = bytes;
+        evicted = evictLocked();
+    }
+    for (const GameResource& res : evicted) {
+        unloadResource(res.id, res.path);
+    }
+}
+
+void ResourceManager::setPrefetch(std::size_t fanout, std::size_t maxInFlight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prefetchFanout_ = fanout;
+    prefetchMaxInFlight_ = maxInFlight;
+}
+
+ResourceStats ResourceManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::shared_future<LoadState> ResourceManager::viewRequestLocked(NodeIndex slot,
+                                                                 LoadPriority priority,
+                                                                 bool pin, bool focus) {
+    GameResource& res = resources_[slot];
+    if (pin) res.pinGeneration = viewGeneration_;
+    if (focus) {
+        ++stats_.views;
+        ++res.viewCount;
+        if (res.state != LoadState::Loaded) ++stats_.stalls;
+        if (res.speculative) ++stats_.prefetchHits;
+    }
+    res.speculative = false;
+    if (res.state == LoadState::Loaded) {
+        ++stats_.hits;
+        lruUnlink(slot);
+        lruPushFront(slot);
+    } else {
+        ++stats_.misses;
+    }
+    return requestLocked(slot, priority, true);
+}
+
+std::size_t ResourceManager::sizeHint(const GameResource& res) const {
+    if (res.state == LoadState::Loaded) return res.bytes;
+    AssetInfo info;
+    if (!res.manifestKey.empty() && manifest_.ready() && manifest_.lookup(res.manifestKey, info)) {
+        return static_cast<std::size_t>(info.size);
+    }
+    return 0;
+}
+
+std::shared_future<LoadState> ResourceManager::requestLocked(NodeIndex slot,
+                                                             LoadPriority priority,
+                                                             bool cancellable) {
+    GameResource& res = resources_[slot];
+    if (res.state == LoadState::Loaded) {
+        return ReadyFuture(LoadState::Loaded);
+    }
+
+    auto it = pending_.find(slot);
+    if (it != pending_.end()) {
+        PendingLoad& load = it->second;
+        load.generation = viewGeneration_;
+        load.cancellable = load.cancellable && cancellable;
+        if (load.speculative && priority != LoadPriority::Speculative) {
+            // Asked for for real before the guess finished: no longer speculative
+            load.speculative = false;
+            --speculativeInFlight_;
+        }
+
+        // Still queued at a lower priority: queue it again, the old entry becomes stale
+        if (res.state == LoadState::Queued && priority < load.priority) {
+            load.priority = priority;
+            load.token = ++nextToken_;
+            const std::uint64_t token = load.token;
+            poolFor(priority).submit(static_cast<int>(priority),
+                                     [this, slot, token]() { runLoad(slot, token); });
+        }
+        return load.future;
+    }
+
+    PendingLoad load;
+    load.promise = std::make_shared<std::promise<LoadState>>();
+    load.future = load.promise->get_future().share();
+    load.priority = priority;
+    load.generation = viewGeneration_;
+    load.cancellable = cancellable;
+    load.token = ++nextToken_;
+    load.speculative = priority == LoadPriority::Speculative;
+    if (load.speculative) ++speculativeInFlight_;
+
+    const std::uint64_t token = load.token;
+    std::shared_future<LoadState> future = load.future;
+    pending_.emplace(slot, std::move(load));
+    res.state = LoadState::Queued;
+
+    poolFor(priority).submit(static_cast<int>(priority), [this, slot, token]() { runLoad(slot, token); });
+    return future;
+}
+
+void ResourceManager::speculateLocked(NodeRef node, const BlockTree& tree) {
+    if (prefetchFanout_ == 0) return;
+
+    std::vector<NodeIndex> candidates = prefetcher_.predict(node, prefetchFanout_);
+
+    // A predicted descent into a child also pulls in that child's likeliest next view
+    // (usually a grandchild of the focus)
+    const std::size_t direct = candidates.size();
+    for (std::size_t i = 0; i < direct; ++i) {
+        const NodeRef candidate = tree.node(candidates[i]);
+        if (candidate.parent() == node) {
+            for (NodeIndex next : prefetcher_.predict(candidate, 1)) {
+                candidates.push_back(next);
+            }
+        }
+    }
+
+    for (NodeIndex slot : candidates) {
+        if (speculativeInFlight_ >= prefetchMaxInFlight_) break;
+        GameResource* res = resourceFor(slot);
+        if (!res || res->state == LoadState::Loaded || pending_.count(slot)) continue;
+
+        requestLocked(slot, LoadPriority::Speculative, true);
+        ++stats_.prefetchIssued;
+    }
+}
+
+void ResourceManager::runLoad(NodeIndex slot, std::uint64_t token) {
+    std::string id;
+    std::filesystem::path path;
+    std::string manifestKey;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(slot);
+        if (it == pending_.end() || it->second.token != token) {
+            return;     // Superseded by a higher-priority entry
+        }
+
+        const PendingLoad& load = it->second;
+        if (load.cancellable && load.generation != viewGeneration_) {
+            resources_[slot].state = LoadState::Unloaded;
+            ++stats_.cancelled;
+            finishLocked(slot, LoadState::Cancelled);
+            return;
+        }
+
+        GameResource& res = resources_[slot];
+        res.state = LoadState::Loading;
+        id = res.id;
+        path = res.path;
+        manifestKey = res.manifestKey;
+    }
+
+    std::size_t bytes = 0;
+    bool packed = false;
+    Metrics::Timer timer(Metric::ResourceLoad);
+    const bool ok = timer.done(loadResource(id, path, manifestKey, &bytes, &packed));
+
+    std::vector<GameResource> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        GameResource& res = resources_[slot];
+        res.state = ok ? LoadState::Loaded : LoadState::Failed;
+        res.speculative = ok && pending_.at(slot).speculative;
+        if (ok) {
+            res.bytes = bytes;
+            ++stats_.loads;
+            if (packed) ++stats_.packLoads;
+            stats_.loadedBytes += bytes;
+            stats_.residentBytes += bytes;
+            lruPushFront(slot);
+            evicted = evictLocked();
+        } else {
+            ++stats_.loadFailures;
+        }
+        if (res.preloadTier) preloadDoneLocked(res);
+        finishLocked(slot, res.state);
+    }
+
+    for (const GameResource& res : evicted) {
+        unloadResource(res.id, res.path);
+    }
+}
+
+void ResourceManager::finishLocked(NodeIndex slot, LoadState result) {
+    auto it = pending_.find(slot);
+    if (it == pending_.end()) return;
+    if (it->second.speculative) --speculativeInFlight_;
+    it->second.promise->set_value(result);
+    pending_.erase(it);
+}
+
+void ResourceManager::lruUnlink(NodeIndex slot) {
+    GameResource& res = resources_[slot];
+    if (res.lruPrev != kNoNode) {
+        resources_[res.lruPrev].lruNext = res.lruNext;
+    } else if (lruHead_ == slot) {
+        lruHead_ = res.lruNext;
+    } else {
+        return;     // Not in the list
+    }
+    if (res.lruNext != kNoNode) {
+        resources_[res.lruNext].lruPrev = res.lruPrev;
+    } else {
+        lruTail_ = res.lruPrev;
+    }
+    res.lruPrev = res.lruNext = kNoNode;
+}
+
+void ResourceManager::lruPushFront(NodeIndex slot) {
+    GameResource& res = resources_[slot];
+    res.lruPrev = kNoNode;
+    res.lruNext = lruHead_;
+    if (lruHead_ != kNoNode) {
+        resources_[lruHead_].lruPrev = slot;
+    } else {
+        lruTail_ = slot;
+    }
+    lruHead_ = slot;
+}
+
+std::vector<GameResource> ResourceManager::evictLocked() {
+    std::vector<GameResource> evicted;
+    if (stats_.budgetBytes == 0) return evicted;
+
+    // Walk from the least recently viewed end, skipping pinned resources
+    NodeIndex slot = lruTail_;
+    while (stats_.residentBytes > stats_.budgetBytes && slot != kNoNode) {
+        GameResource& res = resources_[slot];
+        const NodeIndex prev = res.lruPrev;
+
+        if (!res.resident && res.pinGeneration != viewGeneration_) {
+            lruUnlink(slot);
+            res.state = LoadState::Unloaded;
+            stats_.residentBytes -= res.bytes;
+            stats_.evictedBytes += res.bytes;
+            ++stats_.evictions;
+            if (res.speculative) {
+                ++stats_.prefetchWasted;
+                res.speculative = false;
             }
+            res.bytes = 0;
+            evicted.push_back(res);
         }
+        slot = prev;
     }
+    return evicted;
 }
 
-void ResourceManager::loadResource(GameResource& res) {
-    if (res.loaded) return;
+bool ResourceManager::loadResource(const std::string& id, const std::filesystem::path& path,
+                                   const std::string& manifestKey, std::size_t* bytes,
+                                   bool* packed) const {
+    // Packed assets are handed to the engine as a view into the pack's mapping: no open,
+    // no read, no copy. Packs are never unmounted, so the view outlives the load.
+    if (!manifestKey.empty()) {
+        std::string_view data;
+        bool found = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(packsMutex_);
+            for (const auto& pack : packs_) {
+                if (pack->find(manifestKey, data)) {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (found) {
+            AssetPack::willNeed(data);
+            *bytes = data.size();
+            *packed = true;
 
-    if (!std::filesystem::exists(res.path)) {
-        std::cerr << "[ResourceManager] file not found: " << res.path << '\n';
-        return;
+            // TODO: Replace with the engine's load-from-memory call, passing `data`
+            std::ostringstream line;
+            line << "[ResourceManager] loading " << manifestKey << " from pack (id=" << id << ")\n";
+            std::cout << line.str();
+            return true;
+        }
     }
 
+    // The manifest answers for files under baseDir_ without a syscall. A miss still gets
+    // one stat, in case the file appeared before its inotify event was applied.
+    const std::filesystem::path fullPath = path.is_absolute() ? path : baseDir_ / path;
+    AssetInfo info;
+    std::uintmax_t size = 0;
+    if (!manifestKey.empty() && manifest_.ready() && manifest_.lookup(manifestKey, info)) {
+        size = info.size;
+    } else {
+        std::error_code ec;
+        size = std::filesystem::file_size(fullPath, ec);
+        if (ec) {
+            std::cerr << "[ResourceManager] file not found: " << fullPath << '\n';
+            return false;
+        }
+    }
+    // Stand-in for the engine's memory footprint of the asset
+    *bytes = static_cast<std::size_t>(size);
+
     // ⚠️ This is "abstract loading":
     // In real projects, replace with your game engine's loading function (UE5 Asset / GLTF / FBX etc.)
-    std::cout << "[ResourceManager] loading " << res.path
-              << " (id=" << res.id << ")\n";
+    // Runs on a loader thread, so the line is built first and written in one go.
+    std::ostringstream line;
+    line << "[ResourceManager] loading " << fullPath << " (id=" << id << ")\n";
+    std::cout << line.str();
 
     // TODO: Replace with real loading logic
-    res.loaded = true;
+    return true;
+}
+
+void ResourceManager::unloadResource(const std::string& id, const std::filesystem::path& path) {
+    // Counterpart of loadResource: release the engine asset here
+    std::ostringstream line;
+    line << "[ResourceManager] unloading " << path << " (id=" << id << ")\n";
+    std::cout << line.str();
 }
\ No newline at end of file
@@ -1,38 +1,288 @@
 // ResourceManager.h
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <filesystem>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
+#include "AssetManifest.h"
+#include "AssetPack.h"
 #include "BlockTree.h"
+#include "Prefetcher.h"
+#include "TaskPool.h"
+
+// Lifecycle of a resource in the async loader
+enum class LoadState {
+    Unloaded,   // Not requested (or a queued load was cancelled)
+    Queued,     // Waiting for a loader thread
+    Loading,    // A loader thread is reading it
+    Loaded,     // Available in the engine
+    Failed,     // Last load failed (file missing); a later request retries it
+    Cancelled   // Only reported through futures: the viewer moved on before it started
+};
+
+std::string LoadStateToString(LoadState state);
+
+// Order in which queued loads are served (lower runs first)
+enum class LoadPriority {
+    Focus    = 0,   // The node being viewed
+    Ancestor = 1,   // Its parents up to the city root (nearest first)
+    Preload  = 2,   // Explicit bulk loads (Big shells at startup, ensureLoadedUnder)
+    Prefetch = 3,   // Children loaded ahead of the player
+    Speculative = 4 // Predicted next views; only runs when nothing else is queued
+};
 
 // Game resource description: 3D resource / UI resource corresponding to a block node
 struct GameResource {
     std::string id;                  // ID corresponding to Node
     NodeClass   cls;                 // big / child / tiny
-    std::filesystem::path path;      // Resource file path
-    bool loaded = false;             // Whether loaded into the engine
+    std::filesystem::path path;      // Resource file path (relative to the resource root unless absolute)
+    std::string manifestKey;         // Key in the asset manifest (empty for absolute paths)
+    LoadState state = LoadState::Unloaded;
+    bool registered = false;         // Slot has a resource record
+    bool resident = false;           // Big shell from preloadBigObjects(): never evicted
+    bool speculative = false;        // Loaded by the predictor and not viewed since
+    std::size_t bytes = 0;           // Memory charged while loaded
+    std::uint16_t depth = 0;         // Distance from the city root (preload order)
+    std::uint8_t preloadTier = 0;    // Cold-start preload still waiting: 1 = first frame, 2 = the rest
+    std::uint32_t viewCount = 0;     // Times focused (saved as the "most viewed" list)
+    std::uint64_t pinGeneration = 0; // Pinned while equal to the current view generation (focus + ancestors)
+    NodeIndex lruPrev = kNoNode;     // Loaded-resource LRU list (most recently viewed first)
+    NodeIndex lruNext = kNoNode;
+};
+
+// Cache counters; hits and misses count resources requested by views
+struct ResourceStats {
+    std::uint64_t hits = 0;          // Already loaded when requested
+    std::uint64_t misses = 0;        // Had to be queued
+    std::uint64_t evictions = 0;     // Resources unloaded to stay within the budget
+    std::uint64_t evictedBytes = 0;
+    std::size_t residentBytes = 0;   // Bytes of loaded resources
+    std::size_t budgetBytes = 0;     // 0 = unlimited
+
+    // Loader activity
+    std::uint64_t loads = 0;             // Engine loads that succeeded
+    std::uint64_t loadFailures = 0;      // ... that failed (file missing)
+    std::uint64_t loadedBytes = 0;       // Bytes read by successful loads (including evicted ones)
+    std::uint64_t cancelled = 0;         // Queued loads dropped because the viewer moved on
+    std::uint64_t packLoads = 0;         // Successful loads served from a mounted pack
+
+    // Perceived stalls and predictive prefetch
+    std::uint64_t views = 0;             // ensureLoadedForView calls on a node with a resource
+    std::uint64_t stalls = 0;            // ... whose focused resource was not loaded yet
+    std::uint64_t prefetchIssued = 0;    // Speculative loads queued
+    std::uint64_t prefetchHits = 0;      // Speculatively loaded resources that were then viewed
+    std::uint64_t prefetchWasted = 0;    // ... evicted without being viewed
+
+    // Cold-start preload (preloadBigObjects); times are from the call, 0 until reached
+    std::size_t preloadTotal = 0;        // Resources queued by the preload
+    std::size_t preloadPending = 0;      // ... not finished yet
+    std::size_t preloadFirstFrame = 0;   // ... in the first frame (most viewed / nearest shells)
+    double timeToFirstReadyMs = 0;       // The first frame is loaded (or failed)
+    double timeToAllReadyMs = 0;         // Every preloaded resource is loaded (or failed)
+
+    double prefetchHitRate() const { return prefetchIssued ? double(prefetchHits) / prefetchIssued : 0.0; }
+    double stallRate() const { return views ? double(stalls) / views : 0.0; }
 };
 
-// Resource Manager: Load / preload resources on demand based on BlockTree nodes
+// Several nodes viewed together ("view_batch"): the listed IDs, or every node within
+// `radius` parent / child links of `center` (nearest first). The budgets cut the region
+// short; bytes are estimated from the asset manifest.
+struct ViewRegion {
+    std::vector<std::string> ids;
+    std::string center;
+    std::size_t radius = 0;
+    std::size_t maxNodes = 0;        // 0 = no limit
+    std::size_t maxBytes = 0;        // 0 = no limit
+};
+
+struct ViewBatchResult {
+    struct Entry {
+        NodeRef node;
+        LoadState state;             // Right after queuing: Loaded means ready now
+        bool hasResource;
+    };
+    std::vector<Entry> nodes;            // The region, in load order
+    std::vector<std::string> missing;    // Requested IDs not in the tree
+    std::size_t ancestors = 0;           // Distinct ancestors outside the region
+    std::size_t sharedAncestors = 0;     // Ancestor walks cut short by deduplication
+    std::size_t estimatedBytes = 0;      // Estimated bytes of the region's resources
+    bool truncated = false;              // A budget left nodes out
+};
+
+// Resource Manager: Load / preload resources on demand based on BlockTree nodes.
+// Loads run on a small thread pool in priority order; the event loop only queues them.
 class ResourceManager {
 public:
-    explicit ResourceManager(const std::filesystem::path& baseDir);
+    // `loaderThreads` serve views; bulk preloads run on a separate pool of `ioThreads`, so
+    // a cold start can keep many reads in flight without holding up the player's focus
+    explicit ResourceManager(const std::filesystem::path& baseDir, unsigned loaderThreads = 2,
+                             unsigned ioThreads = 8);
+
+    // Index the resource directory once (see AssetManifest) so loads stop stat'ing files.
+    // Call before serving; without it every load stats its file.
+    bool buildManifest(unsigned threads = 0, bool watch = true);
+
+    ManifestStats manifestStats() const { return manifest_.stats(); }
+
+    // Mount every "*.hpak" archive in `dir` (see AssetPack and tools/pack_builder.cpp).
+    // Assets found in a pack are loaded from its mapping; the rest still come from loose
+    // files. Returns the number of packs mounted.
+    std::size_t mountPacks(const std::filesystem::path& dir);
+
+    std::size_t packCount() const;
+
+    // Big shells in the cold-start preload's first frame
+    static constexpr std::size_t kFirstFrameShells = 64;
 
     // Register a resource record when the block is formally added to BlockTree
-    void registerNode(const std::shared_ptr<Node>& node);
+    // (nodes without a resource file, such as the city root, get none)
+    void registerNode(NodeRef node);
+
+    // Preload all "big objects" (city skeleton / building shell) when starting the game.
+    // Returns at once. The first frame is the kFirstFrameShells shells that rank highest in
+    // the saved `mostViewed` list (see saveMostViewed), topped up with the shallowest ones
+    // when the list is short or missing; it is issued on the I/O pool before the rest. Each
+    // part loads shallowest level first (parents before the shells inside them), then in
+    // list order and by tree slot. stats() reports when the first frame and the whole
+    // preload became ready.
+    void preloadBigObjects(const BlockTree& tree, const std::filesystem::path& mostViewed = {});
+
+    // Write the IDs of the `count` most focused resources, one per line, for the next
+    // cold start. False if the file cannot be written.
+    bool saveMostViewed(const std::filesystem::path& path, std::size_t count) const;
+
+    // Queue all related resources for a node the player views (building / room / tiny object)
+    // and return at once. Queued work for the previous focus that has not started yet is
+    // cancelled. The future resolves to the focused resource's final state (Loaded, Failed or
+    // Cancelled; Unloaded if the node has no resource).
+    std::shared_future<LoadState> ensureLoadedForView(const std::string& id, const BlockTree& tree);
 
-    // Preload all "big objects" (city skeleton / building shell) when starting the game
-    void preloadBigObjects();
+    // ensureLoadedForView for a whole region in one pass: one view generation, region
+    // nodes queued at focus priority in region order, shared ancestors walked and queued
+    // once. Reports each region node's state after queuing.
+    ViewBatchResult ensureLoadedForRegion(const ViewRegion& region, const BlockTree& tree);
 
-    // Ensure all related resources are loaded when the player views a node (building / room / tiny object)
-    void ensureLoadedForView(const std::string& id, const BlockTree& tree);
+    // Queue every resource whose ID lies under `prefix` (e.g. a whole building "001-01")
+    void ensureLoadedUnder(const std::string& prefix, const BlockTree& tree);
+
+    // Current state of a node's resource (Unloaded if it has none)
+    LoadState state(NodeRef node) const;
+
+    // Loads queued or running
+    std::size_t pendingLoads() const;
+
+    // Cap on the bytes of loaded resources (0 = unlimited). When a load pushes the total
+    // over it, least-recently-viewed resources are unloaded; the focus, its ancestors and
+    // preloaded Big shells are never evicted.
+    void setMemoryBudget(std::size_t bytes);
+
+    ResourceStats stats() const;
+
+    // Predictive prefetch: after each view, queue up to `fanout` of the most likely next
+    // nodes (learned from view history) at the lowest priority, with at most `maxInFlight`
+    // speculative loads queued or running. fanout = 0 disables it.
+    void setPrefetch(std::size_t fanout, std::size_t maxInFlight);
+
+    // Block until every queued load has finished or been cancelled
+    void waitIdle() {
+        ioPool_.waitIdle();
+        pool_.waitIdle();
+    }
 
 private:
+    // A load that has been queued and not finished yet
+    struct PendingLoad {
+        std::shared_ptr<std::promise<LoadState>> promise;
+        std::shared_future<LoadState> future;
+        LoadPriority priority;
+        std::uint64_t generation;   // View generation that last asked for it
+        bool cancellable;           // False for loads that must survive focus changes
+        std::uint64_t token;        // Identifies the live queue entry (re-queues bump it)
+        bool speculative;           // Queued by the predictor (counts against the in-flight cap)
+    };
+
     std::filesystem::path baseDir_;
-    std::unordered_map<std::string, GameResource> resources_;
 
-    void loadResource(GameResource& res);
+    mutable std::mutex mutex_;                     // Guards everything below
+    // Indexed by node slot; IDs are resolved through the tree's PathIndex
+    std::vector<GameResource> resources_;
+    // Registered slots per NodeClass, in registration order
+    std::array<std::vector<NodeIndex>, 4> byClass_;
+    std::unordered_map<NodeIndex, PendingLoad> pending_;
+    std::uint64_t viewGeneration_ = 0;
+    std::uint64_t nextToken_ = 0;
+
+    NodeIndex lruHead_ = kNoNode;                  // Most recently viewed loaded resource
+    NodeIndex lruTail_ = kNoNode;
+    ResourceStats stats_;
+
+    Prefetcher prefetcher_;
+    std::size_t prefetchFanout_ = 2;
+    std::size_t prefetchMaxInFlight_ = 2;
+    std::size_t speculativeInFlight_ = 0;
+
+    AssetManifest manifest_;                       // Sizes of the files under baseDir_
+
+    mutable std::shared_mutex packsMutex_;         // Guards packs_ (mounted at startup, read by loaders)
+    std::vector<std::unique_ptr<AssetPack>> packs_;
+
+    // Cold-start preload progress
+    std::chrono::steady_clock::time_point preloadStart_;
+    std::size_t firstTierPending_ = 0;
+
+    // The pools are the last members: joined before the rest is destroyed
+    TaskPool ioPool_;                              // Bulk preloads (LoadPriority::Preload)
+    TaskPool pool_;                                // Everything else
+
+    GameResource* resourceFor(NodeIndex slot);
+
+    TaskPool& poolFor(LoadPriority priority) {
+        return priority == LoadPriority::Preload ? ioPool_ : pool_;
+    }
+
+    // Queue a load (or raise the priority of a queued one); mutex_ must be held
+    std::shared_future<LoadState> requestLocked(NodeIndex slot, LoadPriority priority, bool cancellable);
+
+    // Count a viewed resource (hit / miss, and a view when it is the focus), refresh its
+    // LRU position and queue its load; mutex_ must be held
+    std::shared_future<LoadState> viewRequestLocked(NodeIndex slot, LoadPriority priority,
+                                                    bool pin, bool focus);
+
+    // Expected bytes of a resource: its charge when loaded, else the manifest size (0 if unknown)
+    std::size_t sizeHint(const GameResource& res) const;
+
+    // Queue predicted next views after focusing `node`; mutex_ must be held
+    void speculateLocked(NodeRef node, const BlockTree& tree);
+
+    // Loader thread entry point
+    void runLoad(NodeIndex slot, std::uint64_t token);
+
+    // A preloaded resource finished (loaded or failed); mutex_ must be held
+    void preloadDoneLocked(GameResource& res);
+
+    // Resolve a pending load's future and drop it; mutex_ must be held
+    void finishLocked(NodeIndex slot, LoadState result);
+
+    // LRU list maintenance; mutex_ must be held
+    void lruUnlink(NodeIndex slot);
+    void lruPushFront(NodeIndex slot);
+
+    // Unload least-recently-viewed resources until within budget; mutex_ must be held.
+    // The evicted records are returned so the engine unload can run after unlocking.
+    std::vector<GameResource> evictLocked();
+
+    // The actual engine load / unload (run without the lock); load returns false on failure
+    // and sets `packed` when the bytes came from a pack
+    bool loadResource(const std::string& id, const std::filesystem::path& path,
+                      const std::string& manifestKey, std::size_t* bytes, bool* packed) const;
+    static void unloadResource(const std::string& id, const std::filesystem::path& path);
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+// SecondaryIndex.cpp
+#include "SecondaryIndex.h"
+
+#include <algorithm>
+
+#include "BlockTree.h"
+
+namespace {
+
+void EraseSorted(std::vector<NodeIndex>& slots, NodeIndex slot) {
+    auto it = std::lower_bound(slots.begin(), slots.end(), slot);
+    if (it != slots.end() && *it == slot) slots.erase(it);
+}
+
+} // anonymous namespace
+
+void SecondaryIndex::insert(NodeIndex slot, NodeClass cls, std::int64_t timestamp,
+                            std::string_view name, bool deferSort) {
+    byClass_[static_cast<std::size_t>(cls)].push_back(slot);
+    names_[name].push_back(slot);
+
+    const TimeEntry entry{timestamp, slot};
+    if (timeline_.empty() || !(entry < timeline_.back())) {
+        timeline_.push_back(entry);
+    } else if (deferSort || timelineStale_) {
+        timeline_.push_back(entry);
+        timelineStale_ = true;
+    } else {
+        // A block stamped before the newest one (client-supplied timestamp)
+        timeline_.insert(std::upper_bound(timeline_.begin(), timeline_.end(), entry), entry);
+    }
+}
+
+void SecondaryIndex::erase(NodeIndex slot, NodeClass cls, std::int64_t timestamp,
+                           std::string_view name) {
+    EraseSorted(byClass_[static_cast<std::size_t>(cls)], slot);
+
+    auto name_it = names_.find(name);
+    if (name_it != names_.end()) {
+        EraseSorted(name_it->second, slot);
+        if (name_it->second.empty()) names_.erase(name_it);
+    }
+
+    const TimeEntry entry{timestamp, slot};
+    auto it = timelineStale_
+        ? std::find_if(timeline_.begin(), timeline_.end(),
+                       [&](const TimeEntry& e) { return e.slot == slot; })
+        : std::lower_bound(timeline_.begin(), timeline_.end(), entry);
+    if (it != timeline_.end() && it->slot == slot) timeline_.erase(it);
+}
+
+void SecondaryIndex::refresh() {
+    if (!timelineStale_) return;
+    std::sort(timeline_.begin(), timeline_.end());
+    timelineStale_ = false;
+}
+
+std::size_t SecondaryIndex::memoryUsage() const {
+    std::size_t bytes = timeline_.capacity() * sizeof(TimeEntry);
+    for (const auto& slots : byClass_) bytes += slots.capacity() * sizeof(NodeIndex);
+    // Red-black tree node: three pointers + colour, then the key / value pair
+    constexpr std::size_t kMapNode = 4 * sizeof(void*) + sizeof(NameMap::value_type);
+    for (const auto& entry : names_) bytes += kMapNode + entry.second.capacity() * sizeof(NodeIndex);
+    return bytes;
+}
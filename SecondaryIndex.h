@@ -0,0 +1,64 @@
+// SecondaryIndex.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+
+// From BlockTree.h, which includes this header
+enum class NodeClass : std::uint8_t;
+using NodeIndex = std::uint32_t;
+
+// Indexes over node fields other than the ID, kept by BlockTree for "query":
+//   - per NodeClass: slots in slot (= insertion) order
+//   - timeline: (timestamp, slot) sorted, for time ranges
+//   - names: distinct name -> slots, ordered by name, for name prefixes
+// Slots only grow, so class lists and name postings stay sorted by plain appends.
+// Timestamps normally arrive in order too (addNode stamps "now"); a late one is
+// inserted in place, and restores append and sort once in refresh().
+// The name keys are views into the tree's StringPool, which never moves its strings.
+class SecondaryIndex {
+public:
+    struct TimeEntry {
+        std::int64_t timestamp;
+        NodeIndex slot;
+
+        bool operator<(const TimeEntry& o) const {
+            return timestamp != o.timestamp ? timestamp < o.timestamp : slot < o.slot;
+        }
+    };
+
+    using NameMap = std::map<std::string_view, std::vector<NodeIndex>>;
+
+    // Index a new slot. With `deferSort`, an out-of-order timestamp is appended and the
+    // timeline sorted by the next refresh().
+    void insert(NodeIndex slot, NodeClass cls, std::int64_t timestamp, std::string_view name,
+                bool deferSort = false);
+
+    // Drop a slot again (only used when the genesis root is replaced)
+    void erase(NodeIndex slot, NodeClass cls, std::int64_t timestamp, std::string_view name);
+
+    // Sort the timeline after deferred inserts; cheap when nothing is pending
+    void refresh();
+
+    // False while deferred inserts wait for refresh() (the timeline is unusable then)
+    bool ready() const { return !timelineStale_; }
+
+    const std::vector<NodeIndex>& byClass(NodeClass cls) const {
+        return byClass_[static_cast<std::size_t>(cls)];
+    }
+
+    const std::vector<TimeEntry>& timeline() const { return timeline_; }
+
+    const NameMap& names() const { return names_; }
+
+    std::size_t memoryUsage() const;
+
+private:
+    std::array<std::vector<NodeIndex>, 4> byClass_;
+    std::vector<TimeEntry> timeline_;
+    bool timelineStale_ = false;
+    NameMap names_;
+};
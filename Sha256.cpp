@@ -0,0 +1,558 @@
+// Sha256.cpp
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HC_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kInit[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+alignas(16) constexpr std::uint32_t kRound[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t Rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+inline std::uint32_t LoadBe32(const std::uint8_t* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+           (std::uint32_t(p[2]) << 8)  |  std::uint32_t(p[3]);
+}
+
+inline void StoreBe32(std::uint8_t* p, std::uint32_t v) {
+    p[0] = std::uint8_t(v >> 24);
+    p[1] = std::uint8_t(v >> 16);
+    p[2] = std::uint8_t(v >> 8);
+    p[3] = std::uint8_t(v);
+}
+
+void StateToDigest(const std::uint32_t state[8], Hash256& out) {
+    for (int i = 0; i < 8; ++i) {
+        StoreBe32(out.data() + i * 4, state[i]);
+    }
+}
+
+// ---------------- Portable Kernel ----------------
+
+void CompressPortable(std::uint32_t state[8], const std::uint8_t* data, std::size_t blocks) {
+    std::uint32_t w[64];
+
+    while (blocks--) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = LoadBe32(data + i * 4);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const std::uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const std::uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; ++i) {
+            const std::uint32_t s1  = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+            const std::uint32_t ch  = (e & f) ^ (~e & g);
+            const std::uint32_t t1  = h + s1 + ch + kRound[i] + w[i];
+            const std::uint32_t s0  = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+            const std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint32_t t2  = s0 + maj;
+
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+        data += 64;
+    }
+}
+
+#ifdef HC_SHA256_X86
+
+// ---------------- SHA-NI Kernel ----------------
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void CompressShaNi(std::uint32_t state[8], const std::uint8_t* data, std::size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Reorder state words into the ABEF / CDGH layout expected by sha256rnds2
+    __m128i tmp    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+
+        __m128i w[4];
+        for (int i = 0; i < 4; ++i) {
+            w[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+        }
+
+        // 16 quad-rounds; the message schedule is rolled through w[0..3]
+        for (int j = 0; j < 16; ++j) {
+            __m128i& cur  = w[j & 3];
+            __m128i msg = _mm_add_epi32(
+                cur, _mm_load_si128(reinterpret_cast<const __m128i*>(&kRound[j * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+            if (j >= 3 && j <= 14) {
+                __m128i& next = w[(j + 1) & 3];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(cur, w[(j + 3) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+            if (j >= 1 && j <= 12) {
+                __m128i& prev = w[(j + 3) & 3];
+                prev = _mm_sha256msg1_epu32(prev, cur);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+
+        data += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// ---------------- AVX2 8-Lane Kernel ----------------
+
+#define HC_AVX2 __attribute__((target("avx2")))
+
+HC_AVX2 inline __m256i Rotr8(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// One block for each of eight independent messages. state[i] holds word i of all lanes.
+// Lanes whose bit is clear in activeMask keep their previous state.
+HC_AVX2 void Compress8Avx2(__m256i state[8], const std::uint8_t* const blocks[8], int activeMask) {
+    __m256i w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm256_setr_epi32(
+            static_cast<int>(LoadBe32(blocks[0] + i * 4)), static_cast<int>(LoadBe32(blocks[1] + i * 4)),
+            static_cast<int>(LoadBe32(blocks[2] + i * 4)), static_cast<int>(LoadBe32(blocks[3] + i * 4)),
+            static_cast<int>(LoadBe32(blocks[4] + i * 4)), static_cast<int>(LoadBe32(blocks[5] + i * 4)),
+            static_cast<int>(LoadBe32(blocks[6] + i * 4)), static_cast<int>(LoadBe32(blocks[7] + i * 4)));
+    }
+    for (int i = 16; i < 64; ++i) {
+        const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(w[i - 15], 7), Rotr8(w[i - 15], 18)),
+                                            _mm256_srli_epi32(w[i - 15], 3));
+        const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr8(w[i - 2], 17), Rotr8(w[i - 2], 19)),
+                                            _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; ++i) {
+        const __m256i s1  = _mm256_xor_si256(_mm256_xor_si256(Rotr8(e, 6), Rotr8(e, 11)), Rotr8(e, 25));
+        const __m256i ch  = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        const __m256i t1  = _mm256_add_epi32(
+            _mm256_add_epi32(h, s1),
+            _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(kRound[i])), w[i])));
+        const __m256i s0  = _mm256_xor_si256(_mm256_xor_si256(Rotr8(a, 2), Rotr8(a, 13)), Rotr8(a, 22));
+        const __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                             _mm256_and_si256(b, c));
+        const __m256i t2  = _mm256_add_epi32(s0, maj);
+
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+
+    const __m256i mask = _mm256_setr_epi32(
+        (activeMask & 0x01) ? -1 : 0, (activeMask & 0x02) ? -1 : 0,
+        (activeMask & 0x04) ? -1 : 0, (activeMask & 0x08) ? -1 : 0,
+        (activeMask & 0x10) ? -1 : 0, (activeMask & 0x20) ? -1 : 0,
+        (activeMask & 0x40) ? -1 : 0, (activeMask & 0x80) ? -1 : 0);
+
+    const __m256i out[8] = { a, b, c, d, e, f, g, h };
+    for (int i = 0; i < 8; ++i) {
+        state[i] = _mm256_blendv_epi8(state[i], _mm256_add_epi32(state[i], out[i]), mask);
+    }
+}
+
+// Messages up to this many padded blocks are hashed in AVX2 lanes, longer ones fall back
+constexpr std::size_t kLaneMaxBlocks = 8;
+
+// Hash up to eight short messages in parallel lanes
+HC_AVX2 void HashLanesAvx2(const std::uint8_t* const* data, const std::size_t* lens,
+                           std::size_t count, Hash256* out) {
+    alignas(32) std::uint8_t padded[8][kLaneMaxBlocks * 64];
+    std::size_t blockCount[8] = {};
+    std::size_t maxBlocks = 1;
+
+    for (std::size_t lane = 0; lane < 8; ++lane) {
+        if (lane >= count) {
+            std::memset(padded[lane], 0, 64);
+            blockCount[lane] = 0;
+            continue;
+        }
+        const std::size_t len = lens[lane];
+        const std::size_t blocks = (len + 9 + 63) / 64;
+        std::memcpy(padded[lane], data[lane], len);
+        std::memset(padded[lane] + len, 0, blocks * 64 - len);
+        padded[lane][len] = 0x80;
+        const std::uint64_t bits = std::uint64_t(len) * 8;
+        for (int i = 0; i < 8; ++i) {
+            padded[lane][blocks * 64 - 1 - i] = std::uint8_t(bits >> (i * 8));
+        }
+        blockCount[lane] = blocks;
+        if (blocks > maxBlocks) maxBlocks = blocks;
+    }
+
+    __m256i state[8];
+    for (int i = 0; i < 8; ++i) {
+        state[i] = _mm256_set1_epi32(static_cast<int>(kInit[i]));
+    }
+
+    for (std::size_t blk = 0; blk < maxBlocks; ++blk) {
+        const std::uint8_t* ptrs[8];
+        int active = 0;
+        for (std::size_t lane = 0; lane < 8; ++lane) {
+            if (blk < blockCount[lane]) {
+                ptrs[lane] = padded[lane] + blk * 64;
+                active |= 1 << lane;
+            } else {
+                ptrs[lane] = padded[lane];
+            }
+        }
+        Compress8Avx2(state, ptrs, active);
+    }
+
+    alignas(32) std::uint32_t words[8][8];
+    for (int i = 0; i < 8; ++i) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), state[i]);
+    }
+    for (std::size_t lane = 0; lane < count; ++lane) {
+        std::uint32_t laneState[8];
+        for (int i = 0; i < 8; ++i) laneState[i] = words[i][lane];
+        StateToDigest(laneState, out[lane]);
+    }
+}
+
+// Finish up to eight messages from a common midstate. `padded[lane]` holds each lane's
+// final `blocks` blocks (buffered prefix bytes, tail, padding and length).
+HC_AVX2 void FinishLanesAvx2(const std::uint32_t midstate[8], const std::uint8_t* const padded[8],
+                             std::size_t blocks, std::size_t count, Hash256* out) {
+    __m256i state[8];
+    for (int i = 0; i < 8; ++i) {
+        state[i] = _mm256_set1_epi32(static_cast<int>(midstate[i]));
+    }
+
+    const int active = count >= 8 ? 0xFF : (1 << count) - 1;
+    for (std::size_t blk = 0; blk < blocks; ++blk) {
+        const std::uint8_t* ptrs[8];
+        for (std::size_t lane = 0; lane < 8; ++lane) {
+            ptrs[lane] = padded[lane < count ? lane : 0] + blk * 64;
+        }
+        Compress8Avx2(state, ptrs, active);
+    }
+
+    alignas(32) std::uint32_t words[8][8];
+    for (int i = 0; i < 8; ++i) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), state[i]);
+    }
+    for (std::size_t lane = 0; lane < count; ++lane) {
+        std::uint32_t laneState[8];
+        for (int i = 0; i < 8; ++i) laneState[i] = words[i][lane];
+        StateToDigest(laneState, out[lane]);
+    }
+}
+
+#undef HC_AVX2
+
+bool CpuHasShaNi() {
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    const bool sse41 = (ecx & (1u << 19)) != 0;
+    const bool ssse3 = (ecx & (1u << 9)) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return sse41 && ssse3 && (ebx & (1u << 29)) != 0;
+}
+
+bool CpuHasAvx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // HC_SHA256_X86
+
+// Resolve Auto (and unsupported requests) to a kernel that can actually run here
+Sha256Kernel ResolveSingle(Sha256Kernel kernel) {
+    static const Sha256Kernel detected = Sha256DetectKernel();
+    if (kernel == Sha256Kernel::Auto || kernel == Sha256Kernel::Avx2) return detected;
+    if (kernel == Sha256Kernel::ShaNi && detected != Sha256Kernel::ShaNi) return Sha256Kernel::Portable;
+    return kernel;
+}
+
+void Compress(Sha256Kernel kernel, std::uint32_t state[8], const std::uint8_t* data, std::size_t blocks) {
+#ifdef HC_SHA256_X86
+    if (kernel == Sha256Kernel::ShaNi) {
+        CompressShaNi(state, data, blocks);
+        return;
+    }
+#endif
+    (void)kernel;
+    CompressPortable(state, data, blocks);
+}
+
+} // anonymous namespace
+
+// ---------------- Hex Conversion ----------------
+
+std::string HashToHex(const Hash256& hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(hash.size() * 2, '0');
+    for (std::size_t i = 0; i < hash.size(); ++i) {
+        out[i * 2]     = digits[hash[i] >> 4];
+        out[i * 2 + 1] = digits[hash[i] & 0x0F];
+    }
+    return out;
+}
+
+bool HashFromHex(std::string_view hex, Hash256& out) {
+    if (hex.size() != out.size() * 2) return false;
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    // Decode aside, so a malformed string leaves `out` untouched
+    Hash256 decoded;
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+        const int hi = nibble(hex[i * 2]);
+        const int lo = nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        decoded[i] = static_cast<std::uint8_t>((hi << 4) | lo);
+    }
+    out = decoded;
+    return true;
+}
+
+// ---------------- Kernel Selection ----------------
+
+const char* Sha256KernelName(Sha256Kernel kernel) {
+    switch (kernel) {
+        case Sha256Kernel::Auto:     return "auto";
+        case Sha256Kernel::Portable: return "portable";
+        case Sha256Kernel::ShaNi:    return "sha-ni";
+        case Sha256Kernel::Avx2:     return "avx2-x8";
+    }
+    return "unknown";
+}
+
+Sha256Kernel Sha256DetectKernel() {
+#ifdef HC_SHA256_X86
+    if (CpuHasShaNi()) return Sha256Kernel::ShaNi;
+#endif
+    return Sha256Kernel::Portable;
+}
+
+// ---------------- Streaming SHA-256 ----------------
+
+Sha256::Sha256(Sha256Kernel kernel)
+    : kernel_(ResolveSingle(kernel)) {
+    reset();
+}
+
+void Sha256::reset() {
+    std::memcpy(state_, kInit, sizeof(state_));
+    bufferLen_ = 0;
+    totalLen_  = 0;
+}
+
+void Sha256::update(const void* data, std::size_t len) {
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    totalLen_ += len;
+
+    if (bufferLen_ > 0) {
+        const std::size_t take = std::min(len, sizeof(buffer_) - bufferLen_);
+        std::memcpy(buffer_ + bufferLen_, p, take);
+        bufferLen_ += take;
+        p   += take;
+        len -= take;
+        if (bufferLen_ < sizeof(buffer_)) return;
+        Compress(kernel_, state_, buffer_, 1);
+        bufferLen_ = 0;
+    }
+
+    // Full blocks go straight from the caller's memory
+    const std::size_t blocks = len / 64;
+    if (blocks > 0) {
+        Compress(kernel_, state_, p, blocks);
+        p   += blocks * 64;
+        len -= blocks * 64;
+    }
+
+    if (len > 0) {
+        std::memcpy(buffer_, p, len);
+        bufferLen_ = len;
+    }
+}
+
+Hash256 Sha256::finalize() {
+    const std::uint64_t bits = totalLen_ * 8;
+
+    buffer_[bufferLen_++] = 0x80;
+    if (bufferLen_ > 56) {
+        std::memset(buffer_ + bufferLen_, 0, sizeof(buffer_) - bufferLen_);
+        Compress(kernel_, state_, buffer_, 1);
+        bufferLen_ = 0;
+    }
+    std::memset(buffer_ + bufferLen_, 0, 56 - bufferLen_);
+    for (int i = 0; i < 8; ++i) {
+        buffer_[63 - i] = std::uint8_t(bits >> (i * 8));
+    }
+    Compress(kernel_, state_, buffer_, 1);
+
+    Hash256 out;
+    StateToDigest(state_, out);
+    return out;
+}
+
+Hash256 Sha256::hash(const void* data, std::size_t len, Sha256Kernel kernel) {
+    Sha256 h(kernel);
+    h.update(data, len);
+    return h.finalize();
+}
+
+// ---------------- Multi-Buffer Hashing ----------------
+
+void Sha256Many(const std::uint8_t* const* data, const std::size_t* lens,
+                std::size_t count, Hash256* out, Sha256Kernel kernel) {
+#ifdef HC_SHA256_X86
+    // SHA-NI beats eight AVX2 lanes per core, so Auto only picks AVX2 on CPUs without it
+    static const bool avx2 = CpuHasAvx2();
+    const bool useLanes = avx2 &&
+        (kernel == Sha256Kernel::Avx2 ||
+         (kernel == Sha256Kernel::Auto && Sha256DetectKernel() != Sha256Kernel::ShaNi));
+
+    if (useLanes) {
+        std::size_t i = 0;
+        while (i < count) {
+            const std::uint8_t* laneData[8];
+            std::size_t laneLens[8];
+            std::size_t laneIndex[8];
+            std::size_t lanes = 0;
+
+            // Gather up to eight short messages; long ones are hashed directly
+            for (; i < count && lanes < 8; ++i) {
+                if ((lens[i] + 9 + 63) / 64 > kLaneMaxBlocks) {
+                    out[i] = Sha256::hash(data[i], lens[i], Sha256Kernel::Portable);
+                    continue;
+                }
+                laneData[lanes]  = data[i];
+                laneLens[lanes]  = lens[i];
+                laneIndex[lanes] = i;
+                ++lanes;
+            }
+
+            if (lanes == 0) continue;
+
+            Hash256 laneOut[8];
+            HashLanesAvx2(laneData, laneLens, lanes, laneOut);
+            for (std::size_t l = 0; l < lanes; ++l) {
+                out[laneIndex[l]] = laneOut[l];
+            }
+        }
+        return;
+    }
+#endif
+
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = Sha256::hash(data[i], lens[i], kernel);
+    }
+}
+
+void Sha256FinishMany(const Sha256& prefix, const std::uint8_t* tails, std::size_t tailLen,
+                      std::size_t count, Hash256* out, Sha256Kernel kernel) {
+    const std::size_t used = prefix.bufferLen_ + tailLen;
+    const std::size_t blocks = (used + 9 + 63) / 64;
+    if (blocks > 2) {
+        // Long tails gain nothing from the shared midstate beyond the copy
+        for (std::size_t i = 0; i < count; ++i) {
+            Sha256 h = prefix;
+            h.update(tails + i * tailLen, tailLen);
+            out[i] = h.finalize();
+        }
+        return;
+    }
+
+    // Final blocks with everything but the tail filled in: buffered prefix, padding, length
+    alignas(32) std::uint8_t templ[128] = {};
+    std::memcpy(templ, prefix.buffer_, prefix.bufferLen_);
+    templ[used] = 0x80;
+    const std::uint64_t bits = (prefix.totalLen_ + tailLen) * 8;
+    for (int i = 0; i < 8; ++i) {
+        templ[blocks * 64 - 1 - i] = std::uint8_t(bits >> (i * 8));
+    }
+
+#ifdef HC_SHA256_X86
+    static const bool avx2 = CpuHasAvx2();
+    const bool useLanes = avx2 &&
+        (kernel == Sha256Kernel::Avx2 ||
+         (kernel == Sha256Kernel::Auto && Sha256DetectKernel() != Sha256Kernel::ShaNi));
+
+    if (useLanes) {
+        alignas(32) std::uint8_t padded[8][128];
+        const std::uint8_t* ptrs[8];
+        for (std::size_t lane = 0; lane < 8; ++lane) {
+            std::memcpy(padded[lane], templ, blocks * 64);
+            ptrs[lane] = padded[lane];
+        }
+        for (std::size_t i = 0; i < count; i += 8) {
+            const std::size_t lanes = std::min<std::size_t>(8, count - i);
+            for (std::size_t lane = 0; lane < lanes; ++lane) {
+                std::memcpy(padded[lane] + prefix.bufferLen_, tails + (i + lane) * tailLen, tailLen);
+            }
+            FinishLanesAvx2(prefix.state_, ptrs, blocks, lanes, out + i);
+        }
+        return;
+    }
+#endif
+
+    const Sha256Kernel single = ResolveSingle(kernel);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::memcpy(templ + prefix.bufferLen_, tails + i * tailLen, tailLen);
+        std::uint32_t state[8];
+        std::memcpy(state, prefix.state_, sizeof(state));
+        Compress(single, state, templ, blocks);
+        StateToDigest(state, out[i]);
+    }
+}
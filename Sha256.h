@@ -0,0 +1,72 @@
+// Sha256.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Fixed-size binary hash value (SHA-256 digest)
+using Hash256 = std::array<std::uint8_t, 32>;
+
+// Utility functions: Convert Hash256 to / from lowercase hex for JSON / logging.
+// HashFromHex only writes `out` when the whole string is valid hex of the right length.
+std::string HashToHex(const Hash256& hash);
+bool HashFromHex(std::string_view hex, Hash256& out);
+
+// SHA-256 compression kernels, selected once per process from CPU features
+enum class Sha256Kernel {
+    Auto,       // Best available kernel for this CPU
+    Portable,   // Plain C++ reference implementation
+    ShaNi,      // x86 SHA extensions (one message at a time)
+    Avx2        // 8-lane multi-buffer AVX2 (only used by Sha256Many / Sha256FinishMany)
+};
+
+const char* Sha256KernelName(Sha256Kernel kernel);
+
+// Kernel that Sha256Kernel::Auto resolves to on this CPU
+Sha256Kernel Sha256DetectKernel();
+
+// Streaming SHA-256 (FIPS 180-4). Works entirely on internal fixed buffers, no heap use.
+class Sha256 {
+public:
+    explicit Sha256(Sha256Kernel kernel = Sha256Kernel::Auto);
+
+    void update(const void* data, std::size_t len);
+    void update(std::string_view s) { update(s.data(), s.size()); }
+
+    // Finish the message and return its digest (the object must be reset() before reuse)
+    Hash256 finalize();
+
+    void reset();
+
+    // One-shot convenience
+    static Hash256 hash(const void* data, std::size_t len,
+                        Sha256Kernel kernel = Sha256Kernel::Auto);
+
+private:
+    friend void Sha256FinishMany(const Sha256&, const std::uint8_t*, std::size_t,
+                                 std::size_t, Hash256*, Sha256Kernel);
+
+    std::uint32_t state_[8];
+    std::uint8_t  buffer_[64];
+    std::size_t   bufferLen_ = 0;
+    std::uint64_t totalLen_  = 0;
+    Sha256Kernel  kernel_;
+};
+
+// Hash `count` independent messages. With Sha256Kernel::Avx2 short messages are
+// processed eight at a time in SIMD lanes; other kernels hash them one by one.
+void Sha256Many(const std::uint8_t* const* data, const std::size_t* lens,
+                std::size_t count, Hash256* out,
+                Sha256Kernel kernel = Sha256Kernel::Auto);
+
+// Finish `count` messages that all start with the bytes already fed to `prefix` and end
+// with their own `tailLen`-byte tail (tail i at tails + i * tailLen). The prefix blocks
+// are compressed once; each message only costs its last one or two blocks, eight
+// messages at a time in AVX2 lanes under the same kernel rules as Sha256Many.
+// Used by the nonce search, whose candidates differ only in the trailing nonce.
+void Sha256FinishMany(const Sha256& prefix, const std::uint8_t* tails, std::size_t tailLen,
+                      std::size_t count, Hash256* out,
+                      Sha256Kernel kernel = Sha256Kernel::Auto);
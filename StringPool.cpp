@@ -0,0 +1,66 @@
+// StringPool.cpp
+#include "StringPool.h"
+
+#include <cstring>
+#include <stdexcept>
+
+// Layout inside a chunk: u32 length, then the bytes. A reference is
+// (chunk index << kChunkBits) | offset. Strings longer than a chunk get a chunk of their own.
+
+StringPool::Ref StringPool::intern(std::string_view s) {
+    auto it = dedup_.find(s);
+    if (it != dedup_.end()) return it->second;
+
+    const Ref ref = append(s);
+    dedup_.emplace(get(ref), ref);
+    return ref;
+}
+
+StringPool::Ref StringPool::append(std::string_view s) {
+    const std::size_t need = sizeof(std::uint32_t) + s.size();
+
+    if (used_ + need > kChunkSize) {
+        if (chunks_.size() >= (std::size_t(1) << (32 - kChunkBits))) {
+            throw std::runtime_error("StringPool exhausted");
+        }
+        const std::size_t capacity = need > kChunkSize ? need : kChunkSize;
+        chunks_.emplace_back(new char[capacity]);
+        chunkCapacity_.push_back(capacity);
+        used_ = 0;
+    }
+
+    char* base = chunks_.back().get() + used_;
+    const auto len = static_cast<std::uint32_t>(s.size());
+    std::memcpy(base, &len, sizeof(len));
+    std::memcpy(base + sizeof(len), s.data(), s.size());
+
+    const Ref ref = static_cast<Ref>(((chunks_.size() - 1) << kChunkBits) | used_);
+    used_ += need;
+    // An oversized string fills its chunk completely
+    if (used_ > kChunkSize) used_ = kChunkSize;
+    return ref;
+}
+
+std::string_view StringPool::get(Ref ref) const {
+    const char* base = chunks_[ref >> kChunkBits].get() + (ref & (kChunkSize - 1));
+    std::uint32_t len = 0;
+    std::memcpy(&len, base, sizeof(len));
+    return std::string_view(base + sizeof(len), len);
+}
+
+bool StringPool::find(std::string_view s, Ref* ref) const {
+    auto it = dedup_.find(s);
+    if (it == dedup_.end()) return false;
+    if (ref) *ref = it->second;
+    return true;
+}
+
+std::size_t StringPool::memoryUsage() const {
+    std::size_t bytes = chunks_.capacity() * sizeof(chunks_[0]) +
+                        chunkCapacity_.capacity() * sizeof(std::size_t);
+    for (std::size_t cap : chunkCapacity_) bytes += cap;
+    // Per entry: key + value + next pointer + cached hash, plus one bucket pointer
+    bytes += dedup_.size() * (sizeof(std::string_view) + sizeof(Ref) + 2 * sizeof(void*)) +
+             dedup_.bucket_count() * sizeof(void*);
+    return bytes;
+}
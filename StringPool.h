@@ -0,0 +1,43 @@
+// StringPool.h
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Append-only string storage addressed by 32-bit references.
+// Strings live in fixed-size chunks and never move, so string_views stay valid
+// for the lifetime of the pool. intern() stores each distinct string once.
+class StringPool {
+public:
+    using Ref = std::uint32_t;
+
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    // Store `s` (deduplicated against earlier intern() calls)
+    Ref intern(std::string_view s);
+
+    // Store `s` without deduplication (for values known to be unique, e.g. node IDs)
+    Ref append(std::string_view s);
+
+    std::string_view get(Ref ref) const;
+
+    // Look up a previously interned string without storing it
+    bool find(std::string_view s, Ref* ref) const;
+
+    // Approximate heap bytes held by the pool (chunks + dedup table)
+    std::size_t memoryUsage() const;
+
+private:
+    static constexpr std::size_t kChunkBits = 16;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::vector<std::size_t> chunkCapacity_;
+    std::size_t used_ = kChunkSize;     // Bytes used in the last chunk (full = start a new one)
+    std::unordered_map<std::string_view, Ref> dedup_;
+};
@@ -0,0 +1,66 @@
+// TaskPool.cpp
+#include "TaskPool.h"
+
+#include <exception>
+#include <iostream>
+
+TaskPool::TaskPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void TaskPool::submit(int priority, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push(Task{priority, nextSeq_++, std::move(task)});
+    }
+    cv_.notify_one();
+}
+
+std::size_t TaskPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+void TaskPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCv_.wait(lock, [this]() { return tasks_.empty() && running_ == 0; });
+}
+
+void TaskPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (stopping_) return;
+
+        // priority_queue::top() is const; the task is moved out before pop()
+        std::function<void()> fn = std::move(const_cast<Task&>(tasks_.top()).fn);
+        tasks_.pop();
+        ++running_;
+        lock.unlock();
+
+        try {
+            fn();
+        } catch (const std::exception& e) {
+            std::cerr << "[TaskPool] task failed: " << e.what() << '\n';
+        }
+
+        lock.lock();
+        --running_;
+        if (tasks_.empty() && running_ == 0) {
+            idleCv_.notify_all();
+        }
+    }
+}
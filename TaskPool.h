@@ -0,0 +1,55 @@
+// TaskPool.h
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool fed by a priority queue.
+// Lower priority values run first; tasks of equal priority run in submission order.
+// Tasks still queued when the pool is destroyed are dropped, running ones are joined.
+class TaskPool {
+public:
+    explicit TaskPool(unsigned threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void submit(int priority, std::function<void()> task);
+
+    // Tasks queued but not yet started
+    std::size_t queued() const;
+
+    // Block until the queue is empty and no task is running
+    void waitIdle();
+
+    unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    struct Task {
+        int priority;
+        std::uint64_t seq;
+        std::function<void()> fn;
+
+        // std::priority_queue is a max-heap: "less" means "runs later"
+        bool operator<(const Task& o) const {
+            return priority != o.priority ? priority > o.priority : seq > o.seq;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idleCv_;
+    std::priority_queue<Task> tasks_;
+    std::uint64_t nextSeq_ = 0;
+    std::size_t running_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    void workerLoop();
+};
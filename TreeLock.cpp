@@ -0,0 +1,13 @@
+// TreeLock.cpp
+#include "TreeLock.h"
+
+void TreeLock::lock_shared() {
+    // Pass through the gate: blocks only while a writer is waiting or committing
+    { std::lock_guard<std::mutex> gate(gate_); }
+    mutex_.lock_shared();
+}
+
+void TreeLock::lock() {
+    std::lock_guard<std::mutex> gate(gate_);
+    mutex_.lock();
+}
@@ -0,0 +1,24 @@
+// TreeLock.h
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+
+// Readers/writer lock guarding the BlockTree between request workers.
+// Any number of readers (miner checks, lookups, view requests) share the tree; the
+// single writer takes it exclusively only for the commit itself, so readers never see
+// a node whose parent / child links are half-written. A waiting writer closes the
+// gate to new readers, so a steady stream of reads cannot starve commits.
+// Usable with std::shared_lock / std::unique_lock.
+class TreeLock {
+public:
+    void lock_shared();
+    void unlock_shared() { mutex_.unlock_shared(); }
+
+    void lock();
+    void unlock() { mutex_.unlock(); }
+
+private:
+    std::mutex gate_;               // Held by a writer while it waits for readers to drain
+    std::shared_mutex mutex_;
+};
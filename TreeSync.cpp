@@ -0,0 +1,380 @@
+// TreeSync.cpp
+#include "TreeSync.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Poco/Exception.h>
+#include <Poco/JSON/Parser.h>
+
+#include "RequestDecoder.h"
+#include "RequestHandlers.h"
+
+namespace JSON = Poco::JSON;
+
+namespace {
+
+constexpr std::size_t kDigestBytes = 8;     // Aggregate prefix sent per child (64 bits)
+constexpr std::size_t kMaxIds = 256;        // IDs per sync_digest / sync_blocks request
+constexpr std::size_t kBlockBatch = 512;    // Blocks asked for per sync_blocks request
+constexpr int kIoTimeoutSec = 30;
+
+std::string Digest(const Hash256& aggregate) {
+    return HashToHex(aggregate).substr(0, 2 * kDigestBytes);
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Blocking request / response link to one peer (one JSON line each way)
+class PeerLink {
+public:
+    PeerLink() = default;
+    ~PeerLink() { if (fd_ >= 0) ::close(fd_); }
+
+    PeerLink(const PeerLink&) = delete;
+    PeerLink& operator=(const PeerLink&) = delete;
+
+    bool connect(const std::string& address) {
+        if (address.find('/') != std::string::npos) {
+            sockaddr_un addr{};
+            if (address.size() >= sizeof(addr.sun_path)) return false;
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+            fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                return false;
+            }
+        } else {
+            const auto colon = address.rfind(':');
+            if (colon == std::string::npos) return false;
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* res = nullptr;
+            if (::getaddrinfo(address.substr(0, colon).c_str(), address.c_str() + colon + 1,
+                              &hints, &res) != 0) {
+                return false;
+            }
+            for (addrinfo* ai = res; ai && fd_ < 0; ai = ai->ai_next) {
+                fd_ = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+                if (fd_ >= 0 && ::connect(fd_, ai->ai_addr, ai->ai_addrlen) != 0) {
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+            }
+            ::freeaddrinfo(res);
+            if (fd_ < 0) return false;
+            int one = 1;
+            ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        timeval timeout{kIoTimeoutSec, 0};
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        return true;
+    }
+
+    // Send one request and parse the response line; nullptr on I/O errors,
+    // malformed JSON or "ok": false
+    JSON::Object::Ptr call(const JSON::Object::Ptr& request) {
+        std::ostringstream os;
+        request->stringify(os);
+        std::string line = os.str();
+        line += '\n';
+        if (!writeAll(line)) return nullptr;
+        sent_ += line.size();
+
+        if (!readLine(line)) return nullptr;
+        received_ += line.size() + 1;
+        try {
+            JSON::Parser parser;
+            JSON::Object::Ptr response = parser.parse(line).extract<JSON::Object::Ptr>();
+            if (!response || !response->optValue<bool>("ok", false)) return nullptr;
+            return response;
+        } catch (const Poco::Exception& e) {
+            std::cerr << "[TreeSync] bad response: " << e.displayText() << '\n';
+        } catch (const std::exception& e) {
+            std::cerr << "[TreeSync] bad response: " << e.what() << '\n';
+        }
+        return nullptr;
+    }
+
+    std::uint64_t sent() const { return sent_; }
+    std::uint64_t received() const { return received_; }
+
+private:
+    int fd_ = -1;
+    std::string in_;            // Bytes after the last complete line
+    std::uint64_t sent_ = 0;
+    std::uint64_t received_ = 0;
+
+    bool writeAll(const std::string& data) {
+        std::size_t off = 0;
+        while (off < data.size()) {
+            const ssize_t n = ::send(fd_, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            off += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        char buf[65536];
+        std::size_t scanned = 0;
+        while (true) {
+            const auto end = in_.find('\n', scanned);
+            if (end != std::string::npos) {
+                line.assign(in_, 0, end);
+                in_.erase(0, end + 1);
+                return true;
+            }
+            scanned = in_.size();
+            const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            in_.append(buf, static_cast<std::size_t>(n));
+        }
+    }
+};
+
+JSON::Array::Ptr IdArray(const std::vector<std::string>& ids, std::size_t begin, std::size_t end) {
+    JSON::Array::Ptr arr = new JSON::Array();
+    for (std::size_t i = begin; i < end; ++i) arr->add(ids[i]);
+    return arr;
+}
+
+// Sort, mine and commit one batch of pulled blocks
+bool Apply(std::vector<CandidateBlock>& blocks, NodeState& node) {
+    std::string error;
+    if (!node.tree.sortBatch(blocks, &error)) {
+        std::cerr << "[TreeSync] reject pulled batch: " << error << '\n';
+        return false;
+    }
+    // Replicated history may predate the current difficulty: check the hashes only
+    if (!node.tree.minerBatch(blocks, &error, false)) {
+        std::cerr << "[TreeSync] pulled block failed mining verification, id=" << error << '\n';
+        return false;
+    }
+    if (!commitBatch(blocks, node.tree, node.store, node.resMgr, node.treeLock)) {
+        std::cerr << "[TreeSync] block log write failed, stopping the pull\n";
+        return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+// ---------------- Serving Side ----------------
+
+JSON::Object::Ptr TreeSync::digestResponse(const BlockTree& tree, const JSON::Array::Ptr& ids) {
+    JSON::Array::Ptr nodes = new JSON::Array();
+    const std::size_t count = ids ? std::min<std::size_t>(ids->size(), kMaxIds) : 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const NodeRef node = tree.findNode(ids->getElement<std::string>(static_cast<unsigned>(i)));
+        if (!node) continue;
+
+        JSON::Array::Ptr children = new JSON::Array();
+        for (NodeRef child : node.children()) {
+            JSON::Array::Ptr pair = new JSON::Array();
+            pair->add(std::string(child.id()));
+            pair->add(Digest(tree.aggregateHash(child.slot())));
+            children->add(pair);
+        }
+
+        JSON::Object::Ptr entry = new JSON::Object();
+        entry->set("id", std::string(node.id()));
+        entry->set("hash", HashToHex(node.hash()));
+        entry->set("aggregate", HashToHex(tree.aggregateHash(node.slot())));
+        entry->set("children", children);
+        nodes->add(entry);
+    }
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("nodes", nodes);
+    return body;
+}
+
+JSON::Object::Ptr TreeSync::blocksResponse(const BlockTree& tree, const JSON::Array::Ptr& ids,
+                                           std::size_t max) {
+    // Pre-order walk with an explicit stack (top = next block to send)
+    std::vector<NodeIndex> stack;
+    const std::size_t count = ids ? std::min<std::size_t>(ids->size(), kMaxIds) : 0;
+    for (std::size_t i = count; i-- > 0;) {
+        const NodeRef node = tree.findNode(ids->getElement<std::string>(static_cast<unsigned>(i)));
+        if (node) stack.push_back(node.slot());
+    }
+
+    JSON::Array::Ptr blocks = new JSON::Array();
+    std::vector<NodeIndex> children;
+    for (std::size_t sent = 0; sent < max && !stack.empty(); ++sent) {
+        const NodeRef node = tree.node(stack.back());
+        stack.pop_back();
+        blocks->add(BlockToJson(BlockTree::toBlock(node)));
+
+        children.clear();
+        for (NodeRef child : node.children()) children.push_back(child.slot());
+        stack.insert(stack.end(), children.rbegin(), children.rend());
+    }
+
+    // Everything left has its parent sent already; the next request resumes from here
+    JSON::Array::Ptr more = new JSON::Array();
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        more->add(std::string(tree.node(*it).id()));
+    }
+
+    JSON::Object::Ptr body = new JSON::Object();
+    body->set("blocks", blocks);
+    body->set("more", more);
+    return body;
+}
+
+// ---------------- Pulling Side ----------------
+
+TreeSync::Stats TreeSync::pull(const std::string& address, NodeState& node) {
+    const auto start = std::chrono::steady_clock::now();
+    const BlockTree& tree = node.tree;
+    Stats stats;
+
+    PeerLink link;
+    if (!link.connect(address)) {
+        std::cerr << "[TreeSync] cannot connect to " << address << ": " << std::strerror(errno) << '\n';
+        return stats;
+    }
+    auto finish = [&](bool ok) {
+        stats.ok = ok;
+        stats.bytesSent = link.sent();
+        stats.bytesReceived = link.received();
+        stats.ms = MsSince(start);
+        std::cout << "[TreeSync] " << (ok ? "pulled " : "aborted after ") << stats.blocks
+                  << " blocks from " << address << " in " << stats.rounds << " rounds, "
+                  << stats.ms << " ms (" << stats.compared << " digests compared, "
+                  << stats.conflicts << " conflicts, " << stats.bytesSent << " bytes sent, "
+                  << stats.bytesReceived << " received)\n";
+        return stats;
+    };
+
+    // 1. Level by level from the root: descend only where the digests differ
+    std::vector<std::string> level{std::string(tree.root().id())};
+    std::vector<std::string> next;
+    std::vector<std::string> missing;
+    while (!level.empty()) {
+        for (std::size_t begin = 0; begin < level.size(); begin += kMaxIds) {
+            const std::size_t end = std::min(level.size(), begin + kMaxIds);
+            JSON::Object::Ptr request = new JSON::Object();
+            request->set("mode", "sync_digest");
+            request->set("ids", IdArray(level, begin, end));
+
+            ++stats.rounds;
+            JSON::Object::Ptr response = link.call(request);
+            JSON::Array::Ptr nodes = response ? response->getArray("nodes") : nullptr;
+            if (!nodes) return finish(false);
+
+            for (unsigned i = 0; i < nodes->size(); ++i) {
+                JSON::Object::Ptr entry = nodes->getObject(i);
+                if (!entry) return finish(false);
+                const std::string id = entry->optValue<std::string>("id", "");
+                const NodeRef local = tree.findNode(id);
+                if (!local) continue;
+
+                Hash256 hash{};
+                if (!HashFromHex(entry->optValue<std::string>("hash", ""), hash)) {
+                    std::cerr << "[TreeSync] malformed hash for " << id << " from " << address << '\n';
+                    return finish(false);
+                }
+                if (hash != local.hash()) {
+                    if (local == tree.root()) {
+                        // Different genesis (or a root restored from another chain):
+                        // nothing below can match, so there is nothing to pull
+                        std::cerr << "[TreeSync] root differs from " << address
+                                  << ", not the same chain\n";
+                        ++stats.conflicts;
+                        return finish(false);
+                    }
+                    std::cerr << "[TreeSync] conflict: " << id << " differs from " << address << '\n';
+                    ++stats.conflicts;
+                    continue;
+                }
+                Hash256 aggregate{};
+                if (HashFromHex(entry->optValue<std::string>("aggregate", ""), aggregate) &&
+                    aggregate == tree.aggregateHash(local.slot())) {
+                    continue;
+                }
+
+                JSON::Array::Ptr children = entry->getArray("children");
+                for (unsigned j = 0; children && j < children->size(); ++j) {
+                    JSON::Array::Ptr pair = children->getArray(j);
+                    if (!pair || pair->size() != 2) return finish(false);
+                    const std::string childId = pair->getElement<std::string>(0);
+                    const NodeRef child = tree.findNode(childId);
+                    ++stats.compared;
+                    if (!child) {
+                        missing.push_back(childId);
+                    } else if (Digest(tree.aggregateHash(child.slot())) !=
+                               pair->getElement<std::string>(1)) {
+                        next.push_back(childId);
+                    }
+                }
+            }
+        }
+        level.swap(next);
+        next.clear();
+    }
+    stats.missing = missing.size();
+
+    // 2. Missing subtrees, parents before children, one committed batch per response
+    std::deque<std::string> roots(missing.begin(), missing.end());
+    std::vector<std::string> ids;
+    std::vector<CandidateBlock> blocks;
+    while (!roots.empty()) {
+        const std::size_t take = std::min(roots.size(), kMaxIds);
+        ids.assign(roots.begin(), roots.begin() + static_cast<std::ptrdiff_t>(take));
+        roots.erase(roots.begin(), roots.begin() + static_cast<std::ptrdiff_t>(take));
+
+        JSON::Object::Ptr request = new JSON::Object();
+        request->set("mode", "sync_blocks");
+        request->set("ids", IdArray(ids, 0, ids.size()));
+        request->set("max", static_cast<int>(kBlockBatch));
+
+        ++stats.rounds;
+        JSON::Object::Ptr response = link.call(request);
+        JSON::Array::Ptr arr = response ? response->getArray("blocks") : nullptr;
+        JSON::Array::Ptr more = response ? response->getArray("more") : nullptr;
+        if (!arr || !more) return finish(false);
+
+        blocks.clear();
+        for (unsigned i = 0; i < arr->size(); ++i) {
+            JSON::Object::Ptr item = arr->getObject(i);
+            if (!item) return finish(false);
+            blocks.push_back(BlockFromJson(item));
+        }
+        if (!blocks.empty()) {
+            if (!Apply(blocks, node)) return finish(false);
+            stats.blocks += blocks.size();
+        }
+
+        // Continue where the peer stopped before moving on to other subtrees
+        for (unsigned i = more->size(); i-- > 0;) {
+            roots.push_front(more->getElement<std::string>(i));
+        }
+    }
+
+    return finish(true);
+}
@@ -0,0 +1,62 @@
+// TreeSync.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <Poco/JSON/Array.h>
+#include <Poco/JSON/Object.h>
+
+#include "BlockTree.h"
+
+struct NodeState;
+
+// Anti-entropy between BlockTree replicas: a node that fell behind pulls what it is
+// missing from a peer running the same binary, instead of replaying every add.
+//
+// The puller walks both trees level by level from "root" using the Merkle aggregates
+// (BlockTree::aggregateHash). One "sync_digest" request covers every differing node of
+// a level and returns their children's IDs with a short aggregate prefix; only children
+// whose digest differs are descended into, and children the puller lacks are whole
+// missing subtrees. Those are then fetched with "sync_blocks" in parent-before-child
+// batches, checked like an add_batch (sortBatch + minerBatch, no consensus round:
+// the blocks are already committed on the peer) and committed.
+//
+// Sync is one-way (the puller only gains blocks); two replicas converge by pulling
+// from each other. A node present on both sides with different hashes is a conflict:
+// it is reported and its subtree is left alone. A differing root means the replicas
+// are on different chains, and the pull fails.
+class TreeSync {
+public:
+    struct Stats {
+        bool ok = false;
+        std::size_t rounds = 0;         // Request / response round-trips
+        std::size_t compared = 0;       // Child digests compared
+        std::size_t missing = 0;        // Missing subtree roots found
+        std::size_t blocks = 0;         // Blocks received and committed
+        std::size_t conflicts = 0;
+        std::uint64_t bytesSent = 0;
+        std::uint64_t bytesReceived = 0;
+        double ms = 0;
+    };
+
+    // ---- Serving side (read-only, run under a shared TreeLock) ----
+
+    // "sync_digest": for every known ID its hash, full aggregate and children's digests
+    static Poco::JSON::Object::Ptr digestResponse(const BlockTree& tree,
+                                                  const Poco::JSON::Array::Ptr& ids);
+
+    // "sync_blocks": the subtrees under `ids` in pre-order, at most `max` blocks; subtree
+    // roots not yet sent are returned in "more" for the next request
+    static Poco::JSON::Object::Ptr blocksResponse(const BlockTree& tree,
+                                                  const Poco::JSON::Array::Ptr& ids,
+                                                  std::size_t max);
+
+    // ---- Pulling side ----
+
+    // Pull everything `address` has and this node lacks. `address` is "host:port", or a
+    // Unix socket path when it contains a '/'. Runs on the writer thread (or before
+    // serving): it reads the tree without the lock and locks only to commit.
+    static Stats pull(const std::string& address, NodeState& node);
+};
@@ -1,136 +1,245 @@
 // main.cpp
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "BlockTree.h"
+#include "BlockStore.h"
+#include "Metrics.h"
+#include "RequestDecoder.h"
+#include "RequestHandlers.h"
 #include "ResourceManager.h"
+#include "TaskPool.h"
+#include "TreeLock.h"
+#include "TreeSync.h"
 
-// Use Poco JSON as the JSON library (your original pseudocode closely resembles Poco's style)
 #include <Poco/JSON/Object.h>
-#include <Poco/Dynamic/Var.h>
 
 #include "requester.h"  // Use your existing network interface
 
 namespace JSON   = Poco::JSON;
-namespace Dynamic = Poco::Dynamic;
 
-// ---------------- JSON → CandidateBlock Parsing ----------------
-
-CandidateBlock fromJson(const JSON::Object::Ptr& obj) {
-    CandidateBlock b;
-
-    // id: Globally unique identifier, e.g., "001-01-02"
-    b.id       = obj->optValue<std::string>("id", "");
-    b.parentId = obj->optValue<std::string>("parent_id", "root");
-
-    b.index     = obj->optValue<int>("index", 0);
-
-    long long ts   = obj->optValue<long long>("timestamp", 0);
-    long long rand = obj->optValue<long long>("rand", 0);
-
-    b.timestamp = static_cast<std::int64_t>(ts);
-    b.nonce     = static_cast<std::uint32_t>(rand);
-
-    b.name      = obj->optValue<std::string>("name", "");
-    std::string elePath = obj->optValue<std::string>("ele", "");
-    b.filePath  = std::filesystem::path(elePath);
-
-    std::string clazz = obj->optValue<std::string>("class", "big");
-    b.cls = NodeClassFromString(clazz);
-
-    b.hash = obj->optValue<std::string>("hash", "");
-
-    return b;
-}
-
-// ---------------- Local Mining (BlockTree-only) ----------------
-
-bool localMiner(const JSON::Object::Ptr& obj, BlockTree& tree) {
-    CandidateBlock block = fromJson(obj);
-    return tree.miner(block);
-}
-
-// ---------------- Consensus Interaction with Other Nodes ----------------
+// ---------------- Request Pipeline ----------------
+//
+// The event loop only decodes requests and hands them out:
+//   - reads (check / check_batch / view_node) run on a pool of readers, many at once,
+//     each holding the TreeLock shared;
+//   - adds run one at a time on the writer thread and hold the lock exclusively only
+//     while committing, so a slow peer round-trip never blocks readers.
+// Requests from a connection that still has an add in flight queue behind it on the
+// writer, so each client keeps seeing its own writes. Responses leave in request
+// order per connection either way (Requester tickets).
+
+// Adds queued or running, per connection
+class PendingWrites {
+public:
+    void begin(std::uint64_t conn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++count_[conn];
+    }
 
-// Assume requester.send_check(...) accepts a JSON and returns a JSON
-bool checkWithOthers(const JSON::Object::Ptr& obj) {
-    JSON::Object::Ptr resp = requester.send_check(obj);
-    if (!resp) return false;
+    void finish(std::uint64_t conn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = count_.find(conn);
+        if (it != count_.end() && --it->second == 0) count_.erase(it);
+    }
 
-    return resp->optValue<bool>("answer", false);
-}
+    bool any(std::uint64_t conn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_.count(conn) != 0;
+    }
 
-// ---------------- Complete Process for Adding a New Block ----------------
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::uint64_t, std::size_t> count_;
+};
 
-void handleAdd(const JSON::Object::Ptr& obj,
-               BlockTree& tree,
-               ResourceManager& resMgr) {
-    CandidateBlock block = fromJson(obj);
+// ---------------- Event Loop Entry: main ----------------
 
-    // 1. Local mining verification
-    if (!tree.miner(block)) {
-        std::cerr << "[handleAdd] local miner failed, reject block id="
-                  << block.id << '\n';
-        return;
+// "host:port" → host and port; false (with a message) if malformed
+bool splitAddress(const std::string& option, const std::string& addr,
+                  std::string& host, std::uint16_t& port) {
+    const auto colon = addr.rfind(':');
+    const int value = colon == std::string::npos ? 0 : std::atoi(addr.c_str() + colon + 1);
+    if (value <= 0 || value > 65535) {
+        std::cerr << "[main] " << option << " expects host:port, got " << addr << '\n';
+        return false;
     }
+    host = addr.substr(0, colon);
+    port = static_cast<std::uint16_t>(value);
+    return true;
+}
 
-    // 2. Consortium chain / other nodes consensus
-    if (!checkWithOthers(obj)) {
-        std::cerr << "[handleAdd] remote check failed, reject block id="
-                  << block.id << '\n';
-        return;
+// Command line (no listen option = requests on stdin):
+//   [--listen host:port] [--unix path]
+//   [--peer host:port]... [--peer-unix path]... [--quorum N] [--fanout N] [--peer-timeout ms]
+//   [--sync-from host:port|path]...   (pulled before serving, see TreeSync)
+//   [--difficulty bits]               (proof-of-work target for new blocks, default 0)
+//   [--data-dir path]                 (block store, default "data"; one node per directory)
+bool parseArgs(int argc, char** argv, std::vector<std::string>& syncFrom, unsigned& difficulty,
+               std::filesystem::path& dataDir) {
+    PeerQuorum& peers = requester.peers();
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        std::string host;
+        std::uint16_t port = 0;
+        if (arg == "--listen" && hasValue) {
+            if (!splitAddress(arg, argv[++i], host, port) || !requester.listenTcp(host, port)) {
+                return false;
+            }
+        } else if (arg == "--unix" && hasValue) {
+            if (!requester.listenUnix(argv[++i])) return false;
+        } else if (arg == "--peer" && hasValue) {
+            if (!splitAddress(arg, argv[++i], host, port) || !peers.addTcp(host, port)) {
+                return false;
+            }
+        } else if (arg == "--peer-unix" && hasValue) {
+            if (!peers.addUnix(argv[++i])) return false;
+        } else if (arg == "--quorum" && hasValue) {
+            peers.setQuorum(static_cast<unsigned>(std::atoi(argv[++i])));
+        } else if (arg == "--fanout" && hasValue) {
+            peers.setFanout(static_cast<unsigned>(std::atoi(argv[++i])));
+        } else if (arg == "--peer-timeout" && hasValue) {
+            const int ms = std::atoi(argv[++i]);
+            if (ms <= 0) {
+                std::cerr << "[main] --peer-timeout expects milliseconds\n";
+                return false;
+            }
+            peers.setTimeout(std::chrono::milliseconds(ms));
+        } else if (arg == "--sync-from" && hasValue) {
+            syncFrom.push_back(argv[++i]);
+        } else if (arg == "--difficulty" && hasValue) {
+            const int bits = std::atoi(argv[++i]);
+            if (bits < 0 || bits > static_cast<int>(NonceSearch::kMaxDifficulty)) {
+                std::cerr << "[main] --difficulty expects 0.." << NonceSearch::kMaxDifficulty
+                          << " leading zero bits\n";
+                return false;
+            }
+            difficulty = static_cast<unsigned>(bits);
+        } else if (arg == "--data-dir" && hasValue) {
+            dataDir = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--listen host:port] [--unix path]"
+                      << " [--peer host:port]... [--peer-unix path]... [--quorum N]"
+                      << " [--fanout N] [--peer-timeout ms] [--sync-from host:port|path]..."
+                      << " [--difficulty bits] [--data-dir path]\n";
+            return false;
+        }
     }
-
-    // 3. Write to tree-structured blockchain
-    auto node = tree.addNode(block);
-
-    // 4. Register resource (hand over to ResourceManager for game integration)
-    resMgr.registerNode(node);
-
-    std::cout << "[handleAdd] block accepted, id=" << node->id
-              << ", hash=" << node->hash << '\n';
+    return true;
 }
 
-// ---------------- Event Loop Entry: main ----------------
+int main(int argc, char** argv) {
+    std::vector<std::string> syncFrom;
+    unsigned difficulty = 0;
+    std::filesystem::path dataDir = "data";
+    if (!parseArgs(argc, argv, syncFrom, difficulty, dataDir)) {
+        return 1;
+    }
 
-int main() {
     // Block tree + resource manager
     BlockTree       tree;
+    tree.setDifficulty(difficulty);
     ResourceManager resMgr(std::filesystem::path("objects")); 
     // "objects" directory as resource root, adjustable based on actual needs
+    // Index it once (and follow changes) so loads do not stat each file
+    if (!resMgr.buildManifest()) {
+        std::cerr << "[main] no resource manifest, loads will stat their files\n";
+    }
+    // Packed assets (tools/pack_builder.cpp) are served from their mapping
+    resMgr.mountPacks(std::filesystem::path("objects") / "packs");
+
+    // Durable block log + snapshots (--data-dir, locked against a second node)
+    BlockStore store(dataDir);
+    if (!store.open(tree)) {
+        std::cerr << "[main] cannot open block store, exiting\n";
+        return 1;
+    }
+    registerTree(tree, resMgr);
+    // Cold start: city shells load in the background while requests are already served
+    const std::filesystem::path mostViewed = dataDir / "most_viewed.txt";
+    resMgr.preloadBigObjects(tree, mostViewed);
+
+    // Request workers (declared after the state they use, so they stop first)
+    TreeLock treeLock;
+    NodeState state{tree, store, resMgr, treeLock};
+    PendingWrites writes;
+    TaskPool readers(std::max(2u, std::thread::hardware_concurrency()));
+    TaskPool writer(1);
+
+    // Catch up with other replicas before taking requests
+    for (const std::string& peer : syncFrom) {
+        TreeSync::pull(peer, state);
+    }
 
     // Start network
     requester.run();
 
+    CandidateBlock block;
+    RequestView view;
+
     while (true) {
-        JSON::Object::Ptr request = requester.httprequest();
-        if (!request) continue;
-
-        // Convention: The request contains a field "mode"
-        std::string mode = request->optValue<std::string>("mode", "add");
-
-        if (mode == "add") {
-            // Frontend / other node request: Add a new block
-            handleAdd(request, tree, resMgr);
-
-        } else if (mode == "check") {
-            // Other node query: Help verify if this block is valid
-            bool ok = localMiner(request, tree);
-            requester.send_checkans(ok);
-
-        } else if (mode == "view_node") {
-            // Client only wants to view resources corresponding to a building / room / tiny object
-            std::string id = request->optValue<std::string>("id", "");
-            if (!id.empty()) {
-                resMgr.ensureLoadedForView(id, tree);
+        const std::string* line = requester.nextLine();
+        if (!line) {
+            if (requester.closed()) break;
+            continue;
+        }
+        Metrics::count(Counter::Requests);
+
+        // Convention: The request contains a field "mode".
+        // Flat add / check / view_node / prove lines are decoded straight into `block`;
+        // anything else (batches, unusual shapes) goes through the Poco DOM.
+        std::string mode;
+        JSON::Object::Ptr request;
+        if (DecodeRequest(*line, view) && isFlatMode(view.mode)) {
+            mode = view.mode;
+            BlockFromView(view, block);
+            Metrics::count(Counter::FastDecoded);
+        } else {
+            request = requester.parseRequest(*line);
+            if (!request) {
+                Metrics::count(Counter::InvalidJson);
+                continue;
             }
-            // If you want to send a "resource ready" response to the frontend,
-            // you can define an additional interface like send_view_result(...) in requester.h
+            mode = request->optValue<std::string>("mode", "add");
+            if (isFlatMode(mode)) block = BlockFromJson(request);
+        }
 
+        const Requester::Ticket ticket = requester.ticket();
+        const bool write = isWriteMode(mode);
+        auto task = [&state, &writes, ticket, write, mode, request,
+                     block = std::move(block)]() {
+            bool ok = false;
+            JSON::Object::Ptr body;
+            try {
+                ok = handleRequest(mode, block, request, state, &body);
+            } catch (const std::exception& e) {
+                // Still answer, so the client's later responses are not held back
+                std::cerr << "[main] " << mode << " failed: " << e.what() << '\n';
+            }
+            if (write) writes.finish(ticket.conn);
+            respond(ticket, mode, ok, body);
+        };
+
+        if (write) {
+            writes.begin(ticket.conn);
+            writer.submit(0, std::move(task));
+        } else if (writes.any(ticket.conn)) {
+            writer.submit(0, std::move(task));
         } else {
-            std::cerr << "[main] unknown mode: " << mode << '\n';
+            readers.submit(0, std::move(task));
         }
     }
 
+    writer.waitIdle();
+    readers.waitIdle();
+    store.sync();
+    resMgr.saveMostViewed(mostViewed, 1000);
     return 0;
 }
\ No newline at end of file
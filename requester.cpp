@@ -14,24 +14,83 @@ using namespace Poco::Dynamic;
 
 Requester requester; 
 
+bool Requester::listenTcp(const std::string& host, std::uint16_t port) {
+    if (!server_) server_ = std::make_unique<LineServer>();
+    return server_->listenTcp(host, port);
+}
+
+bool Requester::listenUnix(const std::string& path) {
+    if (!server_) server_ = std::make_unique<LineServer>();
+    return server_->listenUnix(path);
+}
+
 void Requester::run() {
+    if (server_) {
+        if (!server_->start()) {
+            std::cerr << "[Requester] cannot start socket transport" << std::endl;
+            closed_ = true;
+            return;
+        }
+        std::cout << "[Requester] run() called. Serving newline-delimited JSON on sockets."
+                  << std::endl;
+        return;
+    }
     std::cout << "[Requester] run() called. Demo mode: using stdin/stdout as transport."
               << std::endl;
 }
 
 Poco::JSON::Object::Ptr Requester::httprequest() {
+    const std::string* line = nextLine();
+    return line ? parseRequest(*line) : nullptr;
+}
+
+const std::string* Requester::nextLine() {
+    if (server_) {
+        if (batch_.empty()) {
+            // About to wait: push out every response produced so far first. Workers that
+            // answer while we wait see waiting_ and flush themselves.
+            waiting_ = true;
+            server_->flush();
+            const bool ok = server_->nextBatch(batch_);
+            waiting_ = false;
+            if (!ok) {
+                closed_ = true;
+                return nullptr;
+            }
+        }
+        LineServer::Line& line = batch_.front();
+        current_ = issue(line.conn);
+        line_.swap(line.text);
+        batch_.pop_front();
+        return &line_;
+    }
+
     std::cout << "[Requester] Waiting for JSON line on stdin..." << std::endl;
-    std::string line;
-    if (!std::getline(std::cin, line)) {
+    if (!std::getline(std::cin, line_)) {
         std::cerr << "[Requester] EOF or input error." << std::endl;
+        closed_ = true;
         return nullptr;
     }
 
-    if (line.empty()) {
+    if (line_.empty()) {
         std::cerr << "[Requester] Empty line received." << std::endl;
         return nullptr;
     }
 
+    current_ = issue(0);
+    return &line_;
+}
+
+Poco::JSON::Object::Ptr Requester::parseRequest(const std::string& line) {
+    JSON::Object::Ptr obj = parse(line);
+    if (!obj) {
+        // Keep pipelined clients in step: every line gets exactly one response
+        reply(current_, server_ ? "{\"error\":\"invalid JSON object\"}" : "");
+    }
+    return obj;
+}
+
+Poco::JSON::Object::Ptr Requester::parse(const std::string& line) {
     try {
         JSON::Parser parser;
         Var result = parser.parse(line);
@@ -50,6 +109,27 @@ Poco::JSON::Object::Ptr Requester::httprequest() {
 }
 
 Poco::JSON::Object::Ptr Requester::send_check(Poco::JSON::Object::Ptr req) {
+    if (!peers_.empty()) {
+        JSON::Object::Ptr resp = new JSON::Object();
+        if (!req) {
+            resp->set("answer", false);
+            return resp;
+        }
+        std::ostringstream os;
+        req->stringify(os);
+        const PeerQuorum::Result result = peers_.ask(os.str());
+        if (!result.agreed) {
+            std::cerr << "[Requester] send_check(): no quorum (yes " << result.yes << ", no "
+                      << result.no << ", failed " << result.failed << ")" << std::endl;
+        }
+        resp->set("answer", result.agreed);
+        resp->set("yes", result.yes);
+        resp->set("no", result.no);
+        resp->set("failed", result.failed);
+        resp->set("asked", result.asked);
+        return resp;
+    }
+
     // Demo: just print what we "send" and always return answer = true
     std::ostringstream os;
     if (req) {
@@ -65,7 +145,75 @@ Poco::JSON::Object::Ptr Requester::send_check(Poco::JSON::Object::Ptr req) {
 }
 
 void Requester::send_checkans(bool ok) {
+    send_checkans(current_, ok);
+}
+
+void Requester::send_checkans(const Ticket& ticket, bool ok) {
+    if (server_) {
+        reply(ticket, ok ? "{\"answer\":true}" : "{\"answer\":false}");
+        return;
+    }
     // Demo: just print the result
-    std::cout << "[Requester] send_checkans(): answer = "
-              << (ok ? "true" : "false") << std::endl;
+    reply(ticket, std::string("[Requester] send_checkans(): answer = ") + (ok ? "true" : "false"));
+}
+
+void Requester::send_response(Poco::JSON::Object::Ptr resp) {
+    send_response(current_, resp);
+}
+
+void Requester::send_response(const Ticket& ticket, Poco::JSON::Object::Ptr resp) {
+    std::ostringstream os;
+    if (resp) resp->stringify(os);
+
+    if (server_) {
+        reply(ticket, os.str());
+        return;
+    }
+    reply(ticket, "[Requester] response: " + os.str());
+}
+
+Requester::Ticket Requester::issue(std::uint64_t conn) {
+    std::lock_guard<std::mutex> lock(outMutex_);
+    return Ticket{conn, outboxes_[conn].issued++};
+}
+
+void Requester::reply(const Ticket& ticket, std::string line) {
+    std::lock_guard<std::mutex> lock(outMutex_);
+    auto it = outboxes_.find(ticket.conn);
+    if (it == outboxes_.end()) return;
+    Outbox& box = it->second;
+
+    if (ticket.seq != box.next) {
+        // An earlier request on this connection is still being handled
+        box.ready.emplace(ticket.seq, std::move(line));
+        return;
+    }
+
+    deliver(ticket.conn, line);
+    ++box.next;
+    for (auto r = box.ready.begin(); r != box.ready.end() && r->first == box.next;
+         r = box.ready.erase(r)) {
+        deliver(ticket.conn, r->second);
+        ++box.next;
+    }
+    if (box.next == box.issued) {
+        outboxes_.erase(it);
+    }
+
+    // The event loop only flushes before it blocks; while it is blocked, answer now
+    if (server_ && waiting_) {
+        server_->flush();
+    }
+}
+
+void Requester::deliver(std::uint64_t conn, const std::string& line) {
+    if (server_) {
+        server_->send(conn, line);
+        // The request is finished; its connection may close if the client is done
+        server_->done(conn);
+        return;
+    }
+    if (!line.empty()) {
+        std::cout << line << std::endl;
+    }
 }
@@ -4,15 +4,50 @@
 #include <Poco/JSON/Object.h>
 #include <Poco/Dynamic/Var.h>
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "LineServer.h"
+#include "PeerQuorum.h"
+
 /// Simple requester interface used by main.cpp
 /// In your real project, you can replace the implementation
 /// in requester.cpp with real HTTP/Socket logic.
+///
+/// Transport: by default requests are read from stdin (demo mode).
+/// After listenTcp() / listenUnix(), requests come from any number of persistent
+/// socket connections as newline-delimited JSON (pipelining allowed), and every
+/// response is written back on the connection of the request being handled.
+///
+/// Requests may be answered out of order and from worker threads through their
+/// Ticket; responses are still delivered in request order on each connection.
 class Requester {
 public:
+    /// Identifies one request so it can be answered later, from any thread
+    struct Ticket {
+        std::uint64_t conn = 0;     // Connection (0 = stdin)
+        std::uint64_t seq = 0;      // Position among the connection's requests
+    };
+
+    /// Serve clients on a TCP address instead of stdin. Call before run().
+    bool listenTcp(const std::string& host, std::uint16_t port);
+
+    /// Serve clients on a Unix socket path instead of stdin. Call before run().
+    bool listenUnix(const std::string& path);
+
     /// Initialize network / connections.
-    /// In the demo implementation this just prints a message.
+    /// In demo mode this just prints a message; otherwise it starts the epoll I/O thread.
     void run();
 
+    /// True once no more requests can arrive (stdin reached EOF / server stopped)
+    bool closed() const { return closed_; }
+
     /// Wait for one incoming "HTTP request" and return it
     /// as a JSON object.
     ///
@@ -24,24 +59,76 @@ public:
     /// If parsing fails, returns a nullptr.
     Poco::JSON::Object::Ptr httprequest();
 
+    /// Wait for one incoming request line without parsing it, for callers that
+    /// decode the raw text themselves. Returns nullptr if nothing usable arrived
+    /// (check closed()). The line stays valid until the next call.
+    const std::string* nextLine();
+
+    /// Parse a line from nextLine() as a JSON object.
+    /// Returns nullptr if it is not one (on sockets the client gets an error line).
+    Poco::JSON::Object::Ptr parseRequest(const std::string& line);
+
+    /// Ticket of the line returned by the last nextLine() / httprequest()
+    Ticket ticket() const { return current_; }
+
     /// Send a "check" request to other nodes and wait for the
     /// consensus result.
     ///
-    /// Return value format (demo):
+    /// Return value format:
     ///   {
-    ///     "answer": true/false
+    ///     "answer": true/false,
+    ///     "yes": n, "no": n, "failed": n, "asked": n   (only with peers)
     ///   }
     ///
-    /// In a real distributed environment, you should:
-    ///   - broadcast `req` to other nodes,
-    ///   - collect responses,
-    ///   - summarize to a single boolean "answer".
+    /// `req` is broadcast to the configured peers at once and the answer is true as
+    /// soon as a quorum of them agrees (see PeerQuorum). Without peers (demo) the
+    /// answer is always true.
     Poco::JSON::Object::Ptr send_check(Poco::JSON::Object::Ptr req);
 
+    /// Consensus peers used by send_check(). Configure before run().
+    PeerQuorum& peers() { return peers_; }
+
     /// Send back the local check result to whoever asked us.
     ///
-    /// Demo implementation just prints the result.
+    /// Demo implementation just prints the result;
+    /// on sockets it answers {"answer": true/false}.
     void send_checkans(bool ok);
+
+    /// Same, for an earlier request (thread-safe).
+    void send_checkans(const Ticket& ticket, bool ok);
+
+    /// Send a response object for the current request (one line of JSON).
+    void send_response(Poco::JSON::Object::Ptr resp);
+
+    /// Same, for an earlier request (thread-safe).
+    void send_response(const Ticket& ticket, Poco::JSON::Object::Ptr resp);
+
+private:
+    // Responses of one connection, released strictly in request order
+    struct Outbox {
+        std::uint64_t issued = 0;                   // Tickets handed out
+        std::uint64_t next = 0;                     // Next ticket to deliver
+        std::map<std::uint64_t, std::string> ready; // Finished early, waiting for `next`
+    };
+
+    std::unique_ptr<LineServer> server_;
+    PeerQuorum peers_;
+    std::deque<LineServer::Line> batch_;    // Lines taken from the server, not yet handled
+    Ticket current_;                        // Request being handled
+    std::string line_;                      // Text of the request being handled
+    bool closed_ = false;
+
+    std::mutex outMutex_;
+    std::unordered_map<std::uint64_t, Outbox> outboxes_;
+    std::atomic<bool> waiting_{false};      // Event loop is blocked waiting for lines
+
+    Poco::JSON::Object::Ptr parse(const std::string& line);
+    Ticket issue(std::uint64_t conn);
+
+    // Deliver `line` for `ticket` once every earlier request on its connection is answered.
+    // An empty line releases the ticket without output (stdin requests that get no reply).
+    void reply(const Ticket& ticket, std::string line);
+    void deliver(std::uint64_t conn, const std::string& line);
 };
 
 /// Global requester instance used by main.cpp
@@ -0,0 +1,140 @@
+// tools/decode_bench.cpp
+//
+// Compares the two ways a request line becomes a CandidateBlock:
+//   poco  - Poco::JSON::Parser DOM + BlockFromJson (general path)
+//   fast  - DecodeRequest + BlockFromView (single pass over the line)
+// Both run over the same generated add / check / view_node lines; the resulting
+// blocks are compared field by field before anything is timed.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I. tools/decode_bench.cpp RequestDecoder.cpp BlockTree.cpp
+//             MinerCache.cpp NonceSearch.cpp PathIndex.cpp SecondaryIndex.cpp StringPool.cpp
+//             HashBackend.cpp Sha256.cpp
+//             -lPocoJSON -lPocoFoundation
+// Usage:  decode_bench [--lines 100000] [--rounds 5]
+
+#include "RequestDecoder.h"
+
+#include <Poco/JSON/Parser.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kModes[] = {"add", "check", "view_node"};
+const char* const kClasses[] = {"big", "child", "tiny"};
+
+// Request lines shaped like real traffic (IDs three levels deep, full hash)
+std::vector<std::string> MakeLines(std::size_t count) {
+    std::mt19937_64 rng(42);
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const unsigned depth = static_cast<unsigned>(i % 3);
+        std::string id = std::to_string(100 + rng() % 900);
+        std::string parent = "root";
+        for (unsigned d = 0; d < depth; ++d) {
+            parent = id;
+            id += "-" + std::to_string(10 + rng() % 90);
+        }
+
+        Hash256 hash;
+        for (auto& b : hash) b = static_cast<std::uint8_t>(rng());
+
+        std::string line = "{\"mode\":\"" + std::string(kModes[i % 3]) + "\"";
+        line += ",\"id\":\"" + id + "\",\"parent_id\":\"" + parent + "\"";
+        line += ",\"index\":" + std::to_string(rng() % 100);
+        line += ",\"timestamp\":" + std::to_string(1733630000000ull + rng() % 1000000);
+        line += ",\"rand\":" + std::to_string(rng() % 4294967296ull);
+        line += ",\"name\":\"Heritage object " + id + "\"";
+        line += ",\"ele\":\"objects/" + id + ".fbx\"";
+        line += ",\"class\":\"" + std::string(kClasses[depth]) + "\"";
+        line += ",\"hash\":\"" + HashToHex(hash) + "\"}";
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+bool SameBlock(const CandidateBlock& a, const CandidateBlock& b) {
+    return a.id == b.id && a.parentId == b.parentId && a.index == b.index &&
+           a.timestamp == b.timestamp && a.nonce == b.nonce && a.name == b.name &&
+           a.filePath == b.filePath && a.cls == b.cls && a.hash == b.hash;
+}
+
+CandidateBlock ViaPoco(const std::string& line) {
+    Poco::JSON::Parser parser;
+    Poco::Dynamic::Var result = parser.parse(line);
+    return BlockFromJson(result.extract<Poco::JSON::Object::Ptr>());
+}
+
+template <typename Fn>
+double NanosPerLine(const std::vector<std::string>& lines, unsigned rounds, Fn&& fn) {
+    double best = 0;
+    for (unsigned r = 0; r < rounds; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string& line : lines) fn(line);
+        const double ns = std::chrono::duration<double, std::nano>(
+                              std::chrono::steady_clock::now() - start).count() / lines.size();
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 100000;
+    unsigned rounds = 5;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--lines" && i + 1 < argc) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--lines N] [--rounds N]\n";
+            return 1;
+        }
+    }
+    if (count == 0 || rounds == 0) return 1;
+
+    const std::vector<std::string> lines = MakeLines(count);
+    std::size_t bytes = 0;
+    for (const std::string& line : lines) bytes += line.size();
+
+    // Both paths must agree before their speed means anything
+    RequestView view;
+    CandidateBlock block;
+    for (const std::string& line : lines) {
+        if (!DecodeRequest(line, view)) {
+            std::cerr << "fast path rejected: " << line << '\n';
+            return 1;
+        }
+        BlockFromView(view, block);
+        if (!SameBlock(block, ViaPoco(line))) {
+            std::cerr << "paths disagree on: " << line << '\n';
+            return 1;
+        }
+    }
+
+    std::size_t sink = 0;
+    const double poco = NanosPerLine(lines, rounds, [&](const std::string& line) {
+        sink += ViaPoco(line).id.size();
+    });
+    const double fast = NanosPerLine(lines, rounds, [&](const std::string& line) {
+        DecodeRequest(line, view);
+        BlockFromView(view, block);
+        sink += block.id.size();
+    });
+
+    const double avg = static_cast<double>(bytes) / lines.size();
+    std::cout << "lines=" << lines.size() << " avg_bytes=" << avg << " rounds=" << rounds << '\n'
+              << "poco: " << poco << " ns/line, " << avg / poco * 1e3 << " MB/s\n"
+              << "fast: " << fast << " ns/line, " << avg / fast * 1e3 << " MB/s\n"
+              << "speedup: " << poco / fast << "x (checksum " << sink << ")\n";
+    return 0;
+}
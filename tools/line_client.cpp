@@ -0,0 +1,170 @@
+// tools/line_client.cpp
+//
+// Load generator for the node's socket transport (newline-delimited JSON).
+// Opens several persistent connections, keeps up to `pipeline` requests in flight on
+// each one and reports the request rate once every response has come back.
+//
+// Build:  g++ -std=c++17 -O2 -pthread tools/line_client.cpp -o line_client
+// Usage:  line_client (--connect host:port | --unix path) [--conns 8] [--requests 100000]
+//                     [--pipeline 64] [--line '{"mode":"check","id":"x","parent_id":"root"}']
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string host;
+    std::string port;
+    std::string unixPath;
+    unsigned conns = 8;
+    std::size_t requests = 100000;      // Total, split across connections
+    std::size_t pipeline = 64;
+    std::string line = R"({"mode":"check","id":"bench","parent_id":"root","class":"tiny"})";
+};
+
+int Connect(const Options& opt) {
+    if (!opt.unixPath.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, opt.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd >= 0) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool WriteAll(int fd, const char* data, std::size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, data, len);
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Send `count` requests with at most `pipeline` outstanding; returns responses received
+std::size_t RunConnection(const Options& opt, std::size_t count) {
+    const int fd = Connect(opt);
+    if (fd < 0) {
+        std::cerr << "[line_client] connect failed\n";
+        return 0;
+    }
+
+    const std::string request = opt.line + "\n";
+    std::string burst;
+    std::size_t sent = 0;
+    std::size_t received = 0;
+    char buf[64 * 1024];
+
+    while (received < count) {
+        // Top up the window in one write
+        burst.clear();
+        while (sent < count && sent - received < opt.pipeline) {
+            burst += request;
+            ++sent;
+        }
+        if (!burst.empty() && !WriteAll(fd, burst.data(), burst.size())) break;
+
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == '\n') ++received;
+        }
+    }
+
+    ::close(fd);
+    return received;
+}
+
+bool Parse(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--connect" && hasValue) {
+            const std::string addr = argv[++i];
+            const auto colon = addr.rfind(':');
+            if (colon == std::string::npos) return false;
+            opt.host = addr.substr(0, colon);
+            opt.port = addr.substr(colon + 1);
+        } else if (arg == "--unix" && hasValue) {
+            opt.unixPath = argv[++i];
+        } else if (arg == "--conns" && hasValue) {
+            opt.conns = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--requests" && hasValue) {
+            opt.requests = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--pipeline" && hasValue) {
+            opt.pipeline = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--line" && hasValue) {
+            opt.line = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return !opt.unixPath.empty() || !opt.port.empty();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!Parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0] << " (--connect host:port | --unix path) [--conns N]"
+                  << " [--requests N] [--pipeline N] [--line JSON]\n";
+        return 1;
+    }
+
+    std::atomic<std::size_t> total{0};
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned c = 0; c < opt.conns; ++c) {
+        const std::size_t share = opt.requests / opt.conns + (c < opt.requests % opt.conns ? 1 : 0);
+        threads.emplace_back([&, share]() { total += RunConnection(opt, share); });
+    }
+    for (auto& t : threads) t.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "connections=" << opt.conns << " pipeline=" << opt.pipeline
+              << " responses=" << total.load() << "/" << opt.requests
+              << " time=" << seconds << "s"
+              << " rate=" << static_cast<std::size_t>(total.load() / seconds) << " req/s\n";
+    return total.load() == opt.requests ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// tools/pack_builder.cpp
+//
+// Packs the resource files of a subtree into one archive for ResourceManager::mountPacks.
+// Reads the chain from a block store, takes every node under `--prefix` whose resource is a
+// relative path present under `--objects`, and writes their files in ID order to `--out`
+// (default objects/packs/<prefix>.hpak). The node mounts packs from objects/packs at
+// startup; loose files stay where they are and keep serving assets that are not packed.
+//
+// Opening the block store replays (and compacts) its log, so run it while the node is
+// stopped, or point --data at a copy.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I. tools/pack_builder.cpp AssetManifest.cpp AssetPack.cpp
+//             BlockStore.cpp BlockTree.cpp HashBackend.cpp MinerCache.cpp NonceSearch.cpp
+//             PathIndex.cpp SecondaryIndex.cpp Sha256.cpp StringPool.cpp -o pack_builder
+// Usage:  pack_builder --prefix 001-01 [--data data] [--objects objects] [--out path]
+
+#include "AssetManifest.h"
+#include "AssetPack.h"
+#include "BlockStore.h"
+#include "BlockTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string prefix;
+    std::filesystem::path data = "data";
+    std::filesystem::path objects = "objects";
+    std::filesystem::path out;
+};
+
+bool Parse(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        if (arg == "--prefix") {
+            opt.prefix = argv[++i];
+        } else if (arg == "--data") {
+            opt.data = argv[++i];
+        } else if (arg == "--objects") {
+            opt.objects = argv[++i];
+        } else if (arg == "--out") {
+            opt.out = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    if (opt.prefix.empty()) return false;
+    if (opt.out.empty()) opt.out = opt.objects / "packs" / (opt.prefix + ".hpak");
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!Parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0]
+                  << " --prefix ID [--data dir] [--objects dir] [--out path]\n";
+        return 1;
+    }
+
+    BlockTree tree;
+    BlockStore store(opt.data);
+    if (!store.open(tree)) {
+        std::cerr << "[pack_builder] cannot open block store " << opt.data << '\n';
+        return 1;
+    }
+
+    std::vector<PackSource> sources;
+    std::size_t skipped = 0;
+    for (NodeRef node : tree.findByPrefix(opt.prefix)) {
+        const std::filesystem::path path(node.filePath());
+        if (path.empty() || path.is_absolute()) continue;
+
+        PackSource src;
+        src.id = std::string(node.id());
+        src.key = AssetManifest::keyOf(path);
+        src.file = opt.objects / path;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(src.file, ec)) {
+            std::cerr << "[pack_builder] skipping " << src.id << ": no file " << src.file << '\n';
+            ++skipped;
+            continue;
+        }
+        sources.push_back(std::move(src));
+    }
+
+    // The same asset may back several nodes; store it once
+    std::sort(sources.begin(), sources.end(), [](const PackSource& a, const PackSource& b) {
+        return a.key != b.key ? a.key < b.key : a.id < b.id;
+    });
+    sources.erase(std::unique(sources.begin(), sources.end(),
+                              [](const PackSource& a, const PackSource& b) { return a.key == b.key; }),
+                  sources.end());
+
+    if (sources.empty()) {
+        std::cerr << "[pack_builder] nothing to pack under " << opt.prefix << '\n';
+        return 1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(opt.out.parent_path(), ec);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t count = sources.size();
+    if (!AssetPack::write(opt.out, std::move(sources))) return 1;
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "[pack_builder] " << count << " assets packed into " << opt.out << " ("
+              << std::filesystem::file_size(opt.out, ec) << " bytes, " << ms << " ms";
+    if (skipped) std::cout << ", " << skipped << " missing files skipped";
+    std::cout << ")\n";
+    return 0;
+}
@@ -0,0 +1,489 @@
+// tools/tree_bench.cpp
+//
+// Benchmarks the node's hot paths on a synthetic city:
+// city root -> buildings -> rooms -> artifacts (-> ...), with a configurable fan-out per level.
+// The generator is deterministic (same options + seed = same tree), so results from
+// different commits can be compared directly.
+//
+// Timed phases:
+//   addNode, miner (cold / memoized), findNode, verifyNodeAndAncestors, verifySubTree (full / incremental),
+//   prove (+ verifyProof), query, mine (nonce search at 8 / 12 / 16 / 20 bits, in hashes/s),
+//   ensureLoadedForView (+ draining the queued loads), and whole requests (add / check /
+//   view_node lines) through RequestDecoder and the main-loop handlers.
+// Results go to stdout, and optionally to a JSON file and/or a CSV file (rows are appended,
+// so one CSV can collect runs of several commits; use --label to tell them apart).
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I. tools/tree_bench.cpp AssetManifest.cpp AssetPack.cpp
+//             BlockTree.cpp BlockStore.cpp HashBackend.cpp LineServer.cpp Metrics.cpp MinerCache.cpp
+//             NonceSearch.cpp PathIndex.cpp PeerQuorum.cpp Prefetcher.cpp RequestDecoder.cpp
+//             RequestHandlers.cpp ResourceManager.cpp SecondaryIndex.cpp Sha256.cpp StringPool.cpp
+//             TaskPool.cpp TreeLock.cpp TreeSync.cpp requester.cpp
+//             -lPocoJSON -lPocoFoundation
+// Usage:  tree_bench [--fanout 100,10,20] [--depth N] [--seed 1] [--samples 100000]
+//                    [--requests 20000] [--json out.json] [--csv out.csv] [--label name]
+
+#include "BlockStore.h"
+#include "BlockTree.h"
+#include "RequestDecoder.h"
+#include "RequestHandlers.h"
+#include "ResourceManager.h"
+#include "TreeLock.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::vector<unsigned> fanout = {100, 10, 20};   // Children per node, by level
+    std::uint64_t seed = 1;
+    std::size_t samples = 100000;                   // Random lookups / checks / views per phase
+    std::size_t requests = 20000;                   // Request lines per request phase
+    std::string jsonPath;
+    std::string csvPath;
+    std::string label;
+};
+
+struct Result {
+    std::string name;
+    std::size_t ops;
+    double seconds;
+};
+
+// ---------------- City Generator ----------------
+
+const char* const kKinds[] = {"Building", "Room", "Artifact"};
+const char* const kResourceFiles[] = {"building.fbx", "room.fbx", "artifact.fbx"};
+
+// Walks the synthetic tree in pre-order (parents before children) without storing it.
+// IDs are fixed-width decimal segments, e.g. "042-07-013".
+class CityGenerator {
+public:
+    CityGenerator(const std::vector<unsigned>& fanout, std::uint64_t seed)
+        : fanout_(fanout), rng_(seed) {
+        for (unsigned f : fanout_) {
+            width_.push_back(std::max<std::size_t>(3, std::to_string(f).size()));
+        }
+    }
+
+    // Nodes below the root
+    std::size_t total() const {
+        std::size_t total = 0, level = 1;
+        for (unsigned f : fanout_) {
+            level *= f;
+            total += level;
+        }
+        return total;
+    }
+
+    bool next(CandidateBlock& out) {
+        if (!advance()) return false;
+
+        const std::size_t depth = path_.size();
+        out.parentId = depth == 1 ? "root" : ids_[depth - 2];
+        out.index = static_cast<int>(path_.back());
+        out.timestamp = 1733630000000 + static_cast<std::int64_t>(++count_);
+        out.nonce = static_cast<std::uint32_t>(rng_()) | 1u;   // 0 would ask addNode for a random one
+        out.hash = Hash256{};
+
+        const std::size_t kind = std::min<std::size_t>(depth, 3) - 1;
+        out.id = ids_[depth - 1];
+        out.name = std::string(kKinds[kind]) + " " + out.id;
+        out.filePath = kResourceFiles[kind];
+        out.cls = depth == 1 ? NodeClass::Big : depth == 2 ? NodeClass::Child : NodeClass::Tiny;
+        return true;
+    }
+
+private:
+    std::vector<unsigned> fanout_;
+    std::vector<std::size_t> width_;
+    std::mt19937_64 rng_;
+    std::vector<unsigned> path_;        // Child index per level of the current node
+    std::vector<std::string> ids_;      // ID of the current node and its ancestors
+    std::uint64_t count_ = 0;
+    bool started_ = false;
+
+    bool advance() {
+        if (!started_) {
+            started_ = true;
+            if (fanout_.empty() || fanout_[0] == 0) return false;
+            push(0);
+            return true;
+        }
+        // Descend first, then move to the next sibling, climbing out of finished levels
+        if (path_.size() < fanout_.size() && fanout_[path_.size()] > 0) {
+            push(0);
+            return true;
+        }
+        while (!path_.empty()) {
+            const unsigned nextIndex = path_.back() + 1;
+            pop();
+            if (nextIndex < fanout_[path_.size()]) {
+                push(nextIndex);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void push(unsigned index) {
+        std::ostringstream seg;
+        seg << std::setw(static_cast<int>(width_[path_.size()])) << std::setfill('0') << index + 1;
+        ids_.push_back(path_.empty() ? seg.str() : ids_.back() + "-" + seg.str());
+        path_.push_back(index);
+    }
+
+    void pop() {
+        path_.pop_back();
+        ids_.pop_back();
+    }
+};
+
+// ---------------- Helpers ----------------
+
+// Temporary directory, removed with everything in it
+class ScratchDir {
+public:
+    ScratchDir()
+        : path_(std::filesystem::temp_directory_path() /
+                ("tree_bench-" + std::to_string(::getpid()))) {
+        std::filesystem::create_directories(path_);
+    }
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+// Discards std::cout while alive (the handlers log every block they accept)
+class QuietCout {
+public:
+    QuietCout() : saved_(std::cout.rdbuf(nullptr)) {}
+    ~QuietCout() { std::cout.rdbuf(saved_); }
+
+private:
+    std::streambuf* saved_;
+};
+
+template <typename Fn>
+Result Time(const std::string& name, std::size_t ops, Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return Result{name, ops, seconds};
+}
+
+std::string RequestLine(const char* mode, const CandidateBlock& b) {
+    std::string line = "{\"mode\":\"";
+    line += mode;
+    line += "\",\"id\":\"" + b.id + "\",\"parent_id\":\"" + b.parentId + "\"";
+    line += ",\"index\":" + std::to_string(b.index);
+    line += ",\"timestamp\":" + std::to_string(b.timestamp);
+    line += ",\"rand\":" + std::to_string(b.nonce);
+    line += ",\"name\":\"" + b.name + "\",\"ele\":\"" + b.filePath.string() + "\"";
+    line += ",\"class\":\"" + NodeClassToString(b.cls) + "\"";
+    line += ",\"hash\":\"" + HashToHex(b.hash) + "\"}";
+    return line;
+}
+
+// Decode + handle, as a request worker does (the response itself is not sent)
+std::size_t RunRequests(const std::vector<std::string>& lines, NodeState& state) {
+    std::size_t ok = 0;
+    RequestView view;
+    CandidateBlock block;
+    for (const std::string& line : lines) {
+        if (!DecodeRequest(line, view)) continue;
+        BlockFromView(view, block);
+        ok += handleRequest(std::string(view.mode), block, nullptr, state);
+    }
+    return ok;
+}
+
+bool ParseFanout(const std::string& list, std::vector<unsigned>& out) {
+    out.clear();
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const long v = std::strtol(item.c_str(), nullptr, 10);
+        if (v <= 0) return false;
+        out.push_back(static_cast<unsigned>(v));
+    }
+    return !out.empty();
+}
+
+bool Parse(int argc, char** argv, Options& opt) {
+    std::size_t depth = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const std::string value = argv[++i];
+        if (arg == "--fanout") {
+            if (!ParseFanout(value, opt.fanout)) return false;
+        } else if (arg == "--depth") {
+            depth = std::strtoull(value.c_str(), nullptr, 10);
+            if (depth == 0) return false;
+        } else if (arg == "--seed") {
+            opt.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--samples") {
+            opt.samples = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--requests") {
+            opt.requests = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--json") {
+            opt.jsonPath = value;
+        } else if (arg == "--csv") {
+            opt.csvPath = value;
+        } else if (arg == "--label") {
+            opt.label = value;
+        } else {
+            return false;
+        }
+    }
+    // --depth trims the fan-out list or repeats its last entry
+    if (depth != 0) opt.fanout.resize(depth, opt.fanout.back());
+    return opt.samples > 0;
+}
+
+void WriteJson(const std::string& path, const Options& opt, std::size_t nodes,
+               const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "{\n  \"label\": \"" << opt.label << "\",\n  \"seed\": " << opt.seed
+        << ",\n  \"nodes\": " << nodes << ",\n  \"fanout\": [";
+    for (std::size_t i = 0; i < opt.fanout.size(); ++i) {
+        out << (i ? ", " : "") << opt.fanout[i];
+    }
+    out << "],\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+            << ", \"seconds\": " << r.seconds
+            << ", \"ns_per_op\": " << r.seconds * 1e9 / r.ops
+            << ", \"ops_per_sec\": " << r.ops / r.seconds << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+void AppendCsv(const std::string& path, const Options& opt, std::size_t nodes,
+               const std::vector<Result>& results) {
+    const bool fresh = !std::filesystem::exists(path) || std::filesystem::file_size(path) == 0;
+    std::ofstream out(path, std::ios::app);
+    if (fresh) out << "label,nodes,name,ops,seconds,ns_per_op,ops_per_sec\n";
+    for (const Result& r : results) {
+        out << opt.label << ',' << nodes << ',' << r.name << ',' << r.ops << ',' << r.seconds
+            << ',' << r.seconds * 1e9 / r.ops << ',' << r.ops / r.seconds << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!Parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0] << " [--fanout a,b,c] [--depth N] [--seed N]"
+                  << " [--samples N] [--requests N] [--json path] [--csv path] [--label name]\n";
+        return 1;
+    }
+
+    // Scratch directory: resource files for the loader, block store for the handlers
+    const ScratchDir scratchDir;
+    const std::filesystem::path& scratch = scratchDir.path();
+    std::filesystem::create_directories(scratch / "objects");
+    for (const char* file : kResourceFiles) {
+        std::ofstream(scratch / "objects" / file) << std::string(4096, 'x');
+    }
+
+    std::vector<Result> results;
+    std::mt19937_64 rng(opt.seed);
+
+    // 1. addNode: build the whole city
+    BlockTree tree;
+    CityGenerator city(opt.fanout, opt.seed);
+    {
+        // Generated in chunks so only addNode itself is timed
+        std::vector<CandidateBlock> chunk(4096);
+        double seconds = 0;
+        std::size_t added = 0;
+        for (bool more = true; more;) {
+            std::size_t n = 0;
+            while (n < chunk.size() && (more = city.next(chunk[n]))) ++n;
+            const Result r = Time("", n, [&]() {
+                for (std::size_t i = 0; i < n; ++i) tree.addNode(chunk[i]);
+            });
+            seconds += r.seconds;
+            added += n;
+        }
+        results.push_back(Result{"addNode", added, seconds});
+    }
+    const std::size_t nodes = tree.size();
+    std::cerr << "[tree_bench] " << nodes << " nodes, " << tree.memoryUsage() / (1 << 20)
+              << " MiB\n";
+
+    // Random sample of nodes (excluding the root), shared by the lookup phases
+    std::uniform_int_distribution<NodeIndex> pick(1, static_cast<NodeIndex>(nodes - 1));
+    std::vector<CandidateBlock> sample;
+    sample.reserve(opt.samples);
+    for (std::size_t i = 0; i < opt.samples; ++i) {
+        sample.push_back(BlockTree::toBlock(tree.node(pick(rng))));
+    }
+
+    // 2. Lookups and checks
+    std::size_t found = 0;
+    results.push_back(Time("findNode", sample.size(), [&]() {
+        for (const CandidateBlock& b : sample) found += static_cast<bool>(tree.findNode(b.id));
+    }));
+    // Cold: verdict cache off, every check hashes. Memoized: the same checks again.
+    std::size_t mined = 0;
+    tree.setMinerCacheCapacity(0);
+    results.push_back(Time("miner", sample.size(), [&]() {
+        for (const CandidateBlock& b : sample) mined += tree.miner(b);
+    }));
+    std::size_t memoized = 0;
+    tree.setMinerCacheCapacity(sample.size());
+    for (const CandidateBlock& b : sample) tree.miner(b);
+    results.push_back(Time("miner_memoized", sample.size(), [&]() {
+        for (const CandidateBlock& b : sample) memoized += tree.miner(b);
+    }));
+    std::size_t verified = 0;
+    results.push_back(Time("verifyNodeAndAncestors_full", sample.size(), [&]() {
+        for (const CandidateBlock& b : sample) {
+            verified += tree.verifyNodeAndAncestors(b.id, VerifyMode::Full);
+        }
+    }));
+    bool subtree = false;
+    results.push_back(Time("verifySubTree_full", nodes, [&]() {
+        subtree = tree.verifySubTree("root", VerifyMode::Full);
+    }));
+    bool clean = false;
+    results.push_back(Time("verifySubTree_incremental", 1, [&]() {
+        clean = tree.verifySubTree("root", VerifyMode::Incremental);
+    }));
+    std::size_t proven = 0;
+    results.push_back(Time("prove", sample.size(), [&]() {
+        InclusionProof proof;
+        for (const CandidateBlock& b : sample) {
+            proven += tree.prove(b.id, proof) && BlockTree::verifyProof(proof, tree.hasher());
+        }
+    }));
+    // One page of Tiny nodes in a one-second window starting at each sampled node
+    const std::size_t queries = std::min<std::size_t>(sample.size(), 10000);
+    std::size_t answered = 0;
+    results.push_back(Time("query", queries, [&]() {
+        NodeQuery q;
+        q.hasClass = q.hasSince = q.hasUntil = true;
+        q.cls = NodeClass::Tiny;
+        QueryPage page;
+        for (std::size_t i = 0; i < queries; ++i) {
+            q.since = sample[i].timestamp;
+            q.until = q.since + 1000;
+            answered += tree.query(q, page);
+        }
+    }));
+    if (found != sample.size() || mined != sample.size() || memoized != sample.size() ||
+        verified != sample.size() || answered != queries ||
+        proven != sample.size() || !subtree || !clean) {
+        std::cerr << "[tree_bench] consistency check failed\n";
+        return 1;
+    }
+
+    // Nonce search at rising difficulty; "ops" are hashed candidates, so ops/s is hashes/s
+    for (unsigned bits : {8u, 12u, 16u, 20u}) {
+        tree.setDifficulty(bits);
+        const std::size_t blocks = std::min<std::size_t>(sample.size(), 8);
+        std::uint64_t hashes = 0;
+        double seconds = 0;
+        for (std::size_t i = 0; i < blocks; ++i) {
+            CandidateBlock b = sample[i];
+            const NonceSearchResult r = tree.mine(b);
+            if (!r.found || !tree.miner(b)) {
+                std::cerr << "[tree_bench] mining at difficulty " << bits << " failed\n";
+                return 1;
+            }
+            hashes += r.hashes;
+            seconds += r.seconds;
+        }
+        results.push_back(Result{"mine_d" + std::to_string(bits), hashes, seconds});
+    }
+    tree.setDifficulty(0);
+
+    // 3. Resource loading: cold-start preload of the Big shells, then views along the
+    //    sample with loads drained afterwards
+    {
+        QuietCout quiet;
+        ResourceManager resMgr(scratch / "objects");
+        registerTree(tree, resMgr);
+        std::size_t big = 0;
+        for (NodeIndex slot = 0; slot < nodes; ++slot) big += tree.node(slot).cls() == NodeClass::Big;
+        results.push_back(Time("preloadBigObjects", big, [&]() {
+            resMgr.preloadBigObjects(tree);
+            resMgr.waitIdle();
+        }));
+    }
+    {
+        QuietCout quiet;
+        ResourceManager resMgr(scratch / "objects");
+        registerTree(tree, resMgr);
+        results.push_back(Time("ensureLoadedForView", sample.size(), [&]() {
+            for (const CandidateBlock& b : sample) resMgr.ensureLoadedForView(b.id, tree);
+        }));
+        results.push_back(Time("ensureLoadedForView_drain", 1, [&]() { resMgr.waitIdle(); }));
+    }
+
+    // 4. Whole requests against a second node that shares the city's genesis root
+    const std::size_t requests = std::min(opt.requests, nodes - 1);
+    std::vector<std::string> adds, checks, views;
+    for (NodeIndex slot = 1; slot <= requests; ++slot) {
+        const CandidateBlock b = BlockTree::toBlock(tree.node(slot));
+        adds.push_back(RequestLine("add", b));
+        checks.push_back(RequestLine("check", b));
+        views.push_back("{\"mode\":\"view_node\",\"id\":\"" + b.id + "\"}");
+    }
+    if (requests > 0) {
+        QuietCout quiet;
+        BlockTree node;
+        BlockStore store(scratch / "data");
+        ResourceManager resMgr(scratch / "objects");
+        TreeLock treeLock;
+        NodeState state{node, store, resMgr, treeLock};
+        if (!store.open(node)) return 1;
+
+        std::size_t ok = 0;
+        results.push_back(Time("request_add", adds.size(), [&]() { ok += RunRequests(adds, state); }));
+        results.push_back(Time("request_check", checks.size(), [&]() { ok += RunRequests(checks, state); }));
+        results.push_back(Time("request_view_node", views.size(), [&]() { ok += RunRequests(views, state); }));
+        resMgr.waitIdle();
+        store.sync();
+        if (ok != 3 * requests) {
+            std::cerr << "[tree_bench] " << 3 * requests - ok << " requests failed\n";
+            return 1;
+        }
+    }
+
+    for (const Result& r : results) {
+        std::cout << std::left << std::setw(30) << r.name << std::right
+                  << std::setw(10) << r.ops << " ops "
+                  << std::setw(12) << std::fixed << std::setprecision(1) << r.seconds * 1e9 / r.ops
+                  << " ns/op " << std::setw(14) << std::setprecision(0) << r.ops / r.seconds
+                  << " ops/s\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    if (!opt.jsonPath.empty()) WriteJson(opt.jsonPath, opt, nodes, results);
+    if (!opt.csvPath.empty()) AppendCsv(opt.csvPath, opt, nodes, results);
+    return 0;
+}